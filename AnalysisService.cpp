@@ -0,0 +1,334 @@
+#include "AnalysisService.h"
+
+namespace
+{
+    // Lets parallelFor() find the calling worker's batch
+    thread_local const AnalysisService* currentService = nullptr;
+    thread_local int currentWorker = -1;
+
+    void updateMax(std::atomic<juce::int64>& target, juce::int64 value) noexcept
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+AnalysisService::AnalysisService()
+    : ticksPerMillisecond(static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) / 1000.0)
+{
+    const int numWorkers = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        batches.push_back(std::make_unique<Batch>());
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, i));
+        workers.back()->startThread();
+    }
+}
+
+AnalysisService::~AnalysisService()
+{
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto& worker : workers)
+    {
+        workAvailable.signal();
+        worker->stopThread(2000);
+    }
+}
+
+//==============================================================================
+void AnalysisService::Worker::run()
+{
+    currentService = &owner;
+    currentWorker = index;
+
+    while (!threadShouldExit())
+    {
+        if (owner.helpWithBatch(index) || owner.runClients(index, true) || owner.runClients(index, false))
+            continue;
+
+        // Counted as asleep before the last look, so a submit() that this look misses sees the count and signals
+        owner.sleepingWorkers.fetch_add(1);
+
+        if (!owner.hasPendingWork() && owner.workAvailable.wait(100) && owner.hasPendingWork())
+            owner.wakeWorker();  // one signal wakes one worker; pass it on while there is more to do
+
+        owner.sleepingWorkers.fetch_sub(1);
+    }
+}
+
+void AnalysisService::wakeWorker() noexcept
+{
+    if (sleepingWorkers.load() > 0)
+        workAvailable.signal();
+}
+
+bool AnalysisService::hasPendingWork() const
+{
+    for (const auto& batch : batches)
+        if (batch->open.load() && batch->nextTask.load(std::memory_order_relaxed) < batch->numTasks.load(std::memory_order_relaxed))
+            return true;
+
+    // Clients already running are skipped; their worker picks up anything new when it finishes
+    const int numSlots = numSlotsInUse.load(std::memory_order_acquire);
+    for (int i = 0; i < numSlots; ++i)
+    {
+        const auto& slot = slots[static_cast<size_t>(i)];
+        if (slot.pendingJobs.load() > 0 && !slot.running.load() && !slot.paused.load())
+            return true;
+    }
+
+    return false;
+}
+
+bool AnalysisService::runClients(int workerIndex, bool priorityOnly)
+{
+    const int numSlots = numSlotsInUse.load(std::memory_order_acquire);
+    if (numSlots == 0)
+        return false;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[static_cast<size_t>((workerIndex + i) % numSlots)];
+
+        if ((priorityOnly && !slot.priority.load(std::memory_order_relaxed))
+            || slot.pendingJobs.load() == 0 || slot.running.load() || slot.paused.load())
+            continue;
+
+        bool expected = false;
+        if (!slot.running.compare_exchange_strong(expected, true))
+            continue;
+
+        // pause() may have landed between the checks above and the claim
+        if (slot.paused.load())
+        {
+            slot.running.store(false);
+            continue;
+        }
+
+        slot.pendingJobs.exchange(0);
+        slot.client.load()->runAnalysis();
+        slot.running.store(false);
+        return true;
+    }
+
+    return false;
+}
+
+//==============================================================================
+void AnalysisService::runTasks(Batch& batch)
+{
+    const int numTasks = batch.numTasks.load(std::memory_order_relaxed);
+
+    for (int index = batch.nextTask.fetch_add(1, std::memory_order_acq_rel); index < numTasks;
+         index = batch.nextTask.fetch_add(1, std::memory_order_acq_rel))
+    {
+        batch.task(batch.context, index);
+        batch.tasksDone.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool AnalysisService::helpWithBatch(int workerIndex)
+{
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        auto& batch = *batches[i];
+        if (static_cast<int>(i) == workerIndex || !batch.open.load())
+            continue;
+
+        // Registered before looking again, so the owner waits for this helper before reusing the batch
+        batch.helpersInside.fetch_add(1);
+
+        bool helped = false;
+        if (batch.open.load() && batch.nextTask.load(std::memory_order_relaxed) < batch.numTasks.load(std::memory_order_relaxed))
+        {
+            runTasks(batch);
+            helped = true;
+        }
+
+        batch.helpersInside.fetch_sub(1);
+
+        if (helped)
+            return true;
+    }
+
+    return false;
+}
+
+void AnalysisService::runBatch(int numTasks, TaskFunction function, void* context)
+{
+    if (numTasks <= 0)
+        return;
+
+    // A task that calls parallelFor() again while its own worker's batch is open runs the inner loop itself
+    if (currentService != this || currentWorker < 0 || numTasks == 1 || getNumWorkers() < 2
+        || batches[static_cast<size_t>(currentWorker)]->open.load())
+    {
+        for (int i = 0; i < numTasks; ++i)
+            function(context, i);
+
+        return;
+    }
+
+    auto& batch = *batches[static_cast<size_t>(currentWorker)];
+    batch.task = function;
+    batch.context = context;
+    batch.numTasks.store(numTasks, std::memory_order_relaxed);
+    batch.nextTask.store(0, std::memory_order_relaxed);
+    batch.tasksDone.store(0, std::memory_order_relaxed);
+    batch.open.store(true);
+
+    wakeWorker();
+    runTasks(batch);
+
+    // Every index is claimed; wait for helpers still running theirs (at most one task each)
+    batch.open.store(false);
+    while (batch.tasksDone.load(std::memory_order_acquire) < numTasks || batch.helpersInside.load() > 0)
+        juce::Thread::yield();
+}
+
+//==============================================================================
+int AnalysisService::attach(Client& client)
+{
+    const juce::ScopedLock lock(attachLock);
+
+    for (int i = 0; i < maxClients; ++i)
+    {
+        auto& slot = slots[static_cast<size_t>(i)];
+        if (slot.client.load() != nullptr)
+            continue;
+
+        slot.pendingJobs.store(0);
+        slot.priority.store(false);
+        slot.paused.store(true);
+        slot.client.store(&client);
+
+        if (i >= numSlotsInUse.load(std::memory_order_relaxed))
+            numSlotsInUse.store(i + 1, std::memory_order_release);
+
+        return i;
+    }
+
+    jassertfalse; // more instances than the table holds; this one will drop every hop
+    return -1;
+}
+
+void AnalysisService::detach(int slotIndex)
+{
+    const juce::ScopedLock lock(attachLock);
+    auto& slot = slots[static_cast<size_t>(slotIndex)];
+
+    slot.paused.store(true);
+    while (slot.running.load())
+        juce::Thread::sleep(1);
+
+    slot.pendingJobs.store(0);
+    slot.client.store(nullptr);
+}
+
+//==============================================================================
+AnalysisService::Registration::Registration(AnalysisService& s, Client& client)
+    : service(s), slot(s.attach(client))
+{
+    resetStats();
+}
+
+AnalysisService::Registration::~Registration()
+{
+    if (isValid())
+        service.detach(slot);
+}
+
+void AnalysisService::Registration::submit() noexcept
+{
+    if (!isValid())
+    {
+        recordDroppedJob();
+        return;
+    }
+
+    service.slots[static_cast<size_t>(slot)].pendingJobs.fetch_add(1);
+    service.wakeWorker();
+}
+
+void AnalysisService::Registration::recordDroppedJob() noexcept
+{
+    if (isValid())
+        service.slots[static_cast<size_t>(slot)].droppedJobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AnalysisService::Registration::recordQueueLatency(juce::int64 submittedTicks) noexcept
+{
+    if (!isValid())
+        return;
+
+    auto& s = service.slots[static_cast<size_t>(slot)];
+    const auto ticks = juce::jmax(juce::int64{ 0 }, juce::Time::getHighResolutionTicks() - submittedTicks);
+
+    s.jobs.fetch_add(1, std::memory_order_relaxed);
+    s.totalLatencyTicks.fetch_add(ticks, std::memory_order_relaxed);
+    updateMax(s.maxLatencyTicks, ticks);
+}
+
+void AnalysisService::Registration::setPriority(bool shouldHavePriority) noexcept
+{
+    if (isValid())
+        service.slots[static_cast<size_t>(slot)].priority.store(shouldHavePriority, std::memory_order_relaxed);
+}
+
+void AnalysisService::Registration::pause()
+{
+    if (!isValid())
+        return;
+
+    auto& s = service.slots[static_cast<size_t>(slot)];
+    s.paused.store(true);
+
+    while (s.running.load())
+        juce::Thread::sleep(1);
+}
+
+void AnalysisService::Registration::resume()
+{
+    if (!isValid())
+        return;
+
+    service.slots[static_cast<size_t>(slot)].paused.store(false);
+    service.wakeWorker();
+}
+
+AnalysisService::QueueStats AnalysisService::Registration::getStats() const
+{
+    QueueStats stats;
+    if (!isValid())
+        return stats;
+
+    const auto& s = service.slots[static_cast<size_t>(slot)];
+    stats.jobs = s.jobs.load(std::memory_order_relaxed);
+    stats.droppedJobs = s.droppedJobs.load(std::memory_order_relaxed);
+    stats.maxLatencyMs = static_cast<double>(s.maxLatencyTicks.load(std::memory_order_relaxed)) / service.ticksPerMillisecond;
+
+    if (stats.jobs > 0)
+        stats.meanLatencyMs = static_cast<double>(s.totalLatencyTicks.load(std::memory_order_relaxed))
+                            / service.ticksPerMillisecond / static_cast<double>(stats.jobs);
+
+    return stats;
+}
+
+void AnalysisService::Registration::resetStats() noexcept
+{
+    if (!isValid())
+        return;
+
+    auto& s = service.slots[static_cast<size_t>(slot)];
+    s.jobs.store(0, std::memory_order_relaxed);
+    s.droppedJobs.store(0, std::memory_order_relaxed);
+    s.totalLatencyTicks.store(0, std::memory_order_relaxed);
+    s.maxLatencyTicks.store(0, std::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// Process-wide pool that runs pitch analysis for every plugin instance
+//
+// Hold one through juce::SharedResourcePointer, so all instances in a host process share a single
+// set of threads sized to the machine (one core is left for the host's audio thread) instead of
+// each bringing its own. An instance registers a Client in a fixed table and calls submit() when
+// a hop is ready: one atomic add, plus a wake-up only if a worker is asleep, so it is wait-free
+// from processBlock.
+//
+// Idle workers look for work in this order: helping with another worker's parallelFor() batch,
+// then clients marked as priority (editor open or MIDI output live), then everyone else. Each
+// worker starts its scan at a different slot, and a client is only ever run by one worker at a
+// time, so its analysis state needs no locking.
+class AnalysisService
+{
+public:
+    static constexpr int maxClients = 256;
+
+    // Implemented by each instance; runAnalysis() should drain everything submitted so far
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+        virtual void runAnalysis() = 0;
+    };
+
+    // Queue latency (hop ready to analysis started) and jobs run or dropped, kept per instance
+    struct QueueStats
+    {
+        juce::int64 jobs = 0;
+        juce::int64 droppedJobs = 0;
+        double meanLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+    };
+
+    // A client's slot in the table, released on destruction. Starts paused.
+    class Registration
+    {
+    public:
+        Registration(AnalysisService& service, Client& client);
+        ~Registration();
+
+        bool isValid() const { return slot >= 0; }
+
+        // Audio thread: hand over a hop, or count one the instance had to drop
+        void submit() noexcept;
+        void recordDroppedJob() noexcept;
+
+        // Analysis side: call as each hop's analysis starts, with the ticks at which it was submitted
+        void recordQueueLatency(juce::int64 submittedTicks) noexcept;
+
+        void setPriority(bool shouldHavePriority) noexcept;
+
+        // pause() returns once the client is not running and will not be run until resume()
+        void pause();
+        void resume();
+
+        QueueStats getStats() const;
+        void resetStats() noexcept;
+
+    private:
+        AnalysisService& service;
+        const int slot;
+
+        JUCE_DECLARE_NON_COPYABLE(Registration)
+    };
+
+    AnalysisService();
+    ~AnalysisService();
+
+    int getNumWorkers() const { return static_cast<int>(workers.size()); }
+
+    // Runs function(0 .. numTasks - 1) on the calling worker and any idle ones, returning once all
+    // are done. Called from anywhere other than a worker's runAnalysis(), it runs them in turn.
+    // Tasks may call it again: a helper's inner loop is shared out too, the batch owner's runs in turn.
+    template <typename Function>
+    void parallelFor(int numTasks, Function&& function)
+    {
+        using FunctionType = std::remove_reference_t<Function>;
+        runBatch(numTasks, [](void* context, int index) { (*static_cast<FunctionType*>(context))(index); }, &function);
+    }
+
+private:
+    using TaskFunction = void (*)(void*, int);
+
+    struct ClientSlot
+    {
+        std::atomic<Client*> client{ nullptr };
+        std::atomic<int> pendingJobs{ 0 };
+        std::atomic<bool> running{ false };
+        std::atomic<bool> paused{ true };
+        std::atomic<bool> priority{ false };
+
+        std::atomic<juce::int64> jobs{ 0 };
+        std::atomic<juce::int64> droppedJobs{ 0 };
+        std::atomic<juce::int64> totalLatencyTicks{ 0 };
+        std::atomic<juce::int64> maxLatencyTicks{ 0 };
+    };
+
+    // One per worker, since a worker can only be inside one parallelFor() at a time
+    struct Batch
+    {
+        TaskFunction task = nullptr;
+        void* context = nullptr;
+        std::atomic<int> numTasks{ 0 };
+        std::atomic<int> nextTask{ 0 };
+        std::atomic<int> tasksDone{ 0 };
+        std::atomic<int> helpersInside{ 0 };
+        std::atomic<bool> open{ false };
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(AnalysisService& s, int i) : juce::Thread("Pitch Analysis " + juce::String(i + 1)), owner(s), index(i) {}
+        void run() override;
+
+    private:
+        AnalysisService& owner;
+        const int index;
+    };
+
+    int attach(Client& client);
+    void detach(int slot);
+    void wakeWorker() noexcept;
+
+    bool helpWithBatch(int workerIndex);
+    bool runClients(int workerIndex, bool priorityOnly);
+    bool hasPendingWork() const;
+    void runBatch(int numTasks, TaskFunction function, void* context);
+    static void runTasks(Batch& batch);
+
+    std::array<ClientSlot, maxClients> slots;
+    std::atomic<int> numSlotsInUse{ 0 };  // high-water mark, so scans stop early
+    juce::CriticalSection attachLock;      // attach and detach only, never on the audio thread
+
+    std::vector<std::unique_ptr<Batch>> batches;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> sleepingWorkers{ 0 };
+    juce::WaitableEvent workAvailable;
+
+    const double ticksPerMillisecond;
+
+    JUCE_DECLARE_NON_COPYABLE(AnalysisService)
+};
\ No newline at end of file
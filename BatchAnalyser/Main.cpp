@@ -0,0 +1,264 @@
+#include <JuceHeader.h>
+#include "../PitchDetectionEngine.h"
+#include "../PitchTrackFile.h"
+#include "../Tuning.h"
+#include <iostream>
+
+// Offline batch pitch analysis
+//
+// Streams audio files (WAV/AIFF/FLAC) through PitchDetectionEngine faster than real time and writes
+// one "<name>.pitch.csv" track per input: time in seconds and frequency in Hz (0 = unvoiced). Every
+// channel of a multichannel file (up to 16) is tracked on its own, into "<name>.ch0.pitch.csv",
+// "<name>.ch1.pitch.csv" and so on.
+// With --format=track it writes "<name>.ptrk" binary pitch tracks instead (see PitchTrackFile.h),
+// about a third of the size and readable by memory-mapping rather than parsing.
+// Files are analysed in parallel on a thread pool, one engine per file.
+//
+// Built by the BatchAnalyser target in CMakeLists.txt.
+
+namespace
+{
+    struct Options
+    {
+        int bufferSize = 4096;
+        int updatesPerSecond = 30;
+        int numThreads = juce::SystemStats::getNumCpus();
+        PitchDetectionEngine::DifferenceMethod method = PitchDetectionEngine::DifferenceMethod::fft;
+        PitchDetectionEngine::Detector detector = PitchDetectionEngine::Detector::yin;
+        bool multiResolution = false;
+        bool adaptive = false;
+        bool tracking = false;
+        bool binaryTrack = false;
+        juce::File outputDirectory;
+    };
+
+    struct FileReport
+    {
+        juce::File file;
+        juce::String error;
+        double audioSeconds = 0.0;
+        double wallSeconds = 0.0;
+        int numFrames = 0;
+        int numChannels = 1;
+    };
+
+    constexpr int readBlockSize = 1 << 16;
+
+    FileReport analyseFile(const juce::File& input, const Options& options)
+    {
+        FileReport report;
+        report.file = input;
+
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+        // One manager per job; readers are created and used on this thread only
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+        if (reader == nullptr)
+        {
+            report.error = "unsupported or unreadable file";
+            return report;
+        }
+
+        // One track per channel; files with several get "<name>.ch<N>" tracks, N counting from 0
+        const int numChannels = juce::jlimit(1, PitchDetectionEngine::maxChannels, static_cast<int>(reader->numChannels));
+        report.numChannels = numChannels;
+        const auto directory = options.outputDirectory == juce::File() ? input.getParentDirectory() : options.outputDirectory;
+
+        juce::Array<juce::File> outputFiles;
+        juce::OwnedArray<juce::FileOutputStream> outputs;
+        juce::OwnedArray<PitchTrackWriter> tracks;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto outputFile = directory.getChildFile(input.getFileNameWithoutExtension()
+                                                           + (numChannels > 1 ? ".ch" + juce::String(channel) : juce::String())
+                                                           + (options.binaryTrack ? ".ptrk" : ".pitch.csv"));
+            outputFile.deleteFile();
+
+            auto* output = outputs.add(new juce::FileOutputStream(outputFile));
+            if (!output->openedOk())
+            {
+                report.error = "cannot write " + outputFile.getFullPathName();
+                return report;
+            }
+
+            if (!options.binaryTrack)
+                *output << "time_s,frequency_hz\n";
+
+            outputFiles.add(outputFile);
+            tracks.add(new PitchTrackWriter());
+        }
+
+        PitchDetectionEngine engine;
+        engine.setDifferenceMethod(options.method);
+        engine.setDetector(options.detector);
+        engine.setMultiResolution(options.multiResolution);
+        engine.setAdaptiveScheduling(options.adaptive);
+        engine.setPitchTracking(options.tracking);
+        engine.prepare(reader->sampleRate, options.bufferSize, static_cast<int>(reader->sampleRate / options.updatesPerSecond), numChannels);
+
+        PitchDetectionEngine::Snapshot snapshot;
+        engine.prepareSnapshot(snapshot);
+
+        // With more than two channels in the buffer, read() fills every one of them
+        juce::AudioBuffer<float> block(numChannels, readBlockSize);
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples; position += readBlockSize)
+        {
+            const int numToRead = static_cast<int>(juce::jmin(static_cast<juce::int64>(readBlockSize), reader->lengthInSamples - position));
+            reader->read(&block, 0, numToRead, position, true, numChannels > 1);
+
+            engine.processOffline(block.getArrayOfReadPointers(), numToRead, snapshot,
+                [&](const PitchDetectionEngine::Snapshot& frame, int channel, const PitchDetectionEngine::Result& result)
+                {
+                    if (options.binaryTrack)
+                    {
+                        // Notes and velocities as the plugin logs them
+                        const bool voiced = result.frequency > 0.0f;
+                        tracks[channel]->add({ frame.timeInSeconds, result.frequency,
+                                               voiced ? Tuning::standard.lookup(result.frequency).midiNote : -1,
+                                               voiced ? juce::jlimit(0.0f, 127.0f, result.rms * 1000.0f) : 0.0f, channel });
+                    }
+                    else
+                    {
+                        *outputs[channel] << juce::String(frame.timeInSeconds, 4) << "," << juce::String(result.frequency, 3) << "\n";
+                    }
+
+                    if (channel == 0)
+                        ++report.numFrames;
+                });
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (options.binaryTrack && !tracks[channel]->writeTo(*outputs[channel]))
+                report.error = "cannot write " + outputFiles[channel].getFullPathName();
+
+            outputs[channel]->flush();
+        }
+
+        report.audioSeconds = static_cast<double>(reader->lengthInSamples) / reader->sampleRate;
+        report.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+        return report;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: PitchBatchAnalyser [options] <audio files...>\n"
+                     "  --buffer-size=N      analysis window in samples (2048-16384, default 4096)\n"
+                     "  --rate=N             analyses per second (default 30)\n"
+                     "  --threads=N          files analysed in parallel (default: CPU count)\n"
+                     "  --method=fft|direct|incremental\n"
+                     "  --detector=yin|mpm|swipe|perceptual\n"
+                     "  --multi-resolution   use the band-split detector\n"
+                     "  --adaptive           skip silent frames, verify steady ones, extra frames on onsets\n"
+                     "  --tracking           HMM-smoothed pitch track, searching near the previous period\n"
+                     "  --format=csv|track   text .pitch.csv (default) or binary .ptrk pitch tracks\n"
+                     "  --output=DIR         where to write the tracks (default: next to each input)\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    Options options;
+
+    if (args.containsOption("--buffer-size"))
+        options.bufferSize = juce::jlimit(2048, 16384, args.getValueForOption("--buffer-size").getIntValue());
+
+    if (args.containsOption("--rate"))
+        options.updatesPerSecond = juce::jlimit(1, 1000, args.getValueForOption("--rate").getIntValue());
+
+    if (args.containsOption("--threads"))
+        options.numThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+
+    if (args.containsOption("--method"))
+    {
+        const auto method = args.getValueForOption("--method");
+        if (method == "direct")
+            options.method = PitchDetectionEngine::DifferenceMethod::direct;
+        else if (method == "incremental")
+            options.method = PitchDetectionEngine::DifferenceMethod::incremental;
+    }
+
+    if (args.containsOption("--detector"))
+    {
+        const auto detector = args.getValueForOption("--detector");
+        if (detector == "mpm")
+            options.detector = PitchDetectionEngine::Detector::mpm;
+        else if (detector == "swipe")
+            options.detector = PitchDetectionEngine::Detector::swipe;
+        else if (detector == "perceptual")
+            options.detector = PitchDetectionEngine::Detector::perceptual;
+    }
+
+    options.multiResolution = args.containsOption("--multi-resolution");
+    options.adaptive = args.containsOption("--adaptive");
+    options.tracking = args.containsOption("--tracking");
+    options.binaryTrack = args.getValueForOption("--format") == "track";
+
+    if (args.containsOption("--output"))
+    {
+        options.outputDirectory = args.getFileForOption("--output");
+        options.outputDirectory.createDirectory();
+    }
+
+    juce::Array<juce::File> inputs;
+    for (const auto& arg : args.arguments)
+        if (!arg.isOption())
+            inputs.add(arg.resolveAsFile());
+
+    if (inputs.isEmpty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<FileReport> reports(static_cast<size_t>(inputs.size()));
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        juce::ThreadPool pool(juce::jmin(options.numThreads, inputs.size()));
+
+        for (int i = 0; i < inputs.size(); ++i)
+            pool.addJob([&reports, &inputs, &options, i] { reports[static_cast<size_t>(i)] = analyseFile(inputs[i], options); });
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(20);
+    }
+
+    const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+    double totalAudioSeconds = 0.0;
+    int failures = 0;
+
+    for (const auto& report : reports)
+    {
+        if (report.error.isNotEmpty())
+        {
+            std::cout << report.file.getFullPathName() << ": " << report.error << "\n";
+            ++failures;
+            continue;
+        }
+
+        totalAudioSeconds += report.audioSeconds;
+        std::cout << report.file.getFileName() << ": " << report.numFrames << " frames"
+                  << (report.numChannels > 1 ? " x " + juce::String(report.numChannels) + " channels, " : juce::String(", "))
+                  << juce::String(report.audioSeconds / juce::jmax(1.0e-9, report.wallSeconds), 1) << "x realtime\n";
+    }
+
+    std::cout << "Total: " << juce::String(totalAudioSeconds, 1) << " s of audio in " << juce::String(wallSeconds, 2)
+              << " s (" << juce::String(totalAudioSeconds / juce::jmax(1.0e-9, wallSeconds), 1) << "x realtime, "
+              << options.numThreads << " threads)\n";
+
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,522 @@
+#include <JuceHeader.h>
+#include "../PitchDetectionEngine.h"
+#include "../YinCore.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Headless CPU and accuracy benchmark for the detection pipeline
+//
+// Timing: every buffer size / update rate / sample rate combination is fed a harmonic test
+// signal in host-sized blocks. The collection side (DC blocker, ring buffer, snapshot - what
+// processBlock does) and the analysis side (windowing plus YIN or the band-split detector - what
+// runPitchDetection does on the analysis thread) are timed separately, as ns per input sample
+// and as worst-case time per audio callback / per analysis frame. With --sparse the tone is gated
+// on and off every half second, which is where adaptive scheduling (--adaptive) pays off; the
+// engine's full / verified / skipped frame counts are reported alongside. --detector=mpm|swipe|perceptual
+// swaps YIN for the McLeod, SWIPE-style or perceptual detector; each run also reports the engine's own
+// per-frame cost for the detector and, for accuracy runs, its mean confidence.
+//
+// Allocation: the collection side runs in processBlock and must not touch the heap, so every timing
+// run counts the allocations it makes (collectAllocations). Any at all make the tool exit with 1.
+//
+// Accuracy: steady sine and harmonic-rich tones on every MIDI note 12-127 (C0-G9 as the plugin
+// names them, ~16 Hz to ~12.5 kHz; the README's looser "c0 to g10" does not match those names).
+// A frame is a gross error when it is unvoiced or more than 50 cents off; cents RMSE is over the
+// remaining frames.
+//
+// Accumulation (--accumulation, instead of the runs above): the direct YIN core instantiated with
+// float, double and pairwise accumulation (see YinCore.h) on 8192 and 16384 sample windows, one
+// harmonic tone per octave. Reports time per frame, cents error, and how far each policy's CMND
+// curve strays from the double one.
+//
+// Self-test (--selftest, instead of the runs above): cross-checks every SIMD kernel the CPU supports
+// against the scalar ones (SimdKernels::runSelfTest) and exits with 1 on any mismatch.
+//
+// Results go to stdout (or --output=FILE) as JSON. Built by the Benchmarks target in CMakeLists.txt.
+
+namespace
+{
+    thread_local int allocationCheckDepth = 0;
+    std::atomic<int> checkedAllocations{ 0 };
+
+    // Counts heap allocations made on this thread while alive
+    struct ScopedAllocationCheck
+    {
+        ScopedAllocationCheck() noexcept { ++allocationCheckDepth; }
+        ~ScopedAllocationCheck() noexcept { --allocationCheckDepth; }
+    };
+}
+
+// A plugin cannot safely replace the global allocator (the symbols can interpose on the host or be
+// bypassed by it), but this is a program of its own. new[] and the nothrow forms forward here;
+// over-aligned allocations are not counted.
+void* operator new(std::size_t size)
+{
+    if (allocationCheckDepth > 0)
+        checkedAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int bufferSizes[] = { 2048, 4096, 8192, 16384 };
+    const int updateRates[] = { 2, 4, 8, 12, 20, 30 };
+    const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+
+    constexpr int hostBlockSize = 512;
+    constexpr int firstNote = 12;  // C0
+    constexpr int lastNote = 127;  // G9
+    constexpr float grossErrorCents = 50.0f;
+
+    enum class Signal { sine, harmonic };
+
+    // Bandlimited tone: the fundamental alone, or eight 1/k harmonics below Nyquist
+    void generateTone(std::vector<float>& dest, double sampleRate, double frequency, Signal signal)
+    {
+        const int numHarmonics = signal == Signal::sine ? 1 : 8;
+        const double twoPi = juce::MathConstants<double>::twoPi;
+
+        for (size_t i = 0; i < dest.size(); ++i)
+        {
+            double value = 0.0;
+            for (int k = 1; k <= numHarmonics && frequency * k < sampleRate * 0.45; ++k)
+                value += std::sin(twoPi * frequency * k * static_cast<double>(i) / sampleRate) / k;
+
+            dest[i] = static_cast<float>(0.4 * value);
+        }
+    }
+
+    int hopSizeFor(double sampleRate, int updatesPerSecond)
+    {
+        return juce::jmax(1, static_cast<int>(sampleRate / updatesPerSecond));
+    }
+
+    double elapsedNs(Clock::time_point start)
+    {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    //==============================================================================
+    using DifferenceMethod = PitchDetectionEngine::DifferenceMethod;
+    using Detector = PitchDetectionEngine::Detector;
+
+    const char* detectorName(Detector detector, bool multiResolution)
+    {
+        if (multiResolution)
+            return "multiResolution";
+
+        switch (detector)
+        {
+            case Detector::mpm:        return "mpm";
+            case Detector::swipe:      return "swipe";
+            case Detector::perceptual: return "perceptual";
+            case Detector::yin:        break;
+        }
+
+        return "yin";
+    }
+
+    struct EngineOptions
+    {
+        DifferenceMethod method = DifferenceMethod::fft;
+        Detector detector = Detector::yin;
+        bool adaptive = false;
+        bool tracking = false;
+        bool sparse = false;
+    };
+
+    juce::var runTiming(const EngineOptions& options, double sampleRate, int bufferSize, int updatesPerSecond, bool multiResolution, double seconds)
+    {
+        PitchDetectionEngine engine;
+        engine.setDifferenceMethod(options.method);
+        engine.setDetector(options.detector);
+        engine.setAdaptiveScheduling(options.adaptive);
+        engine.setPitchTracking(options.tracking);
+        engine.setMultiResolution(multiResolution);
+        engine.prepare(sampleRate, bufferSize, hopSizeFor(sampleRate, updatesPerSecond));
+
+        PitchDetectionEngine::Snapshot snapshot;
+        engine.prepareSnapshot(snapshot);
+
+        std::vector<float> input(static_cast<size_t>(sampleRate * seconds));
+        generateTone(input, sampleRate, 220.0, Signal::harmonic);
+
+        if (options.sparse)
+            for (size_t i = 0; i < input.size(); ++i)
+                if ((static_cast<int>(2.0 * static_cast<double>(i) / sampleRate) & 1) != 0)
+                    input[i] = 0.0f;
+
+        double collectNs = 0.0, worstCallbackNs = 0.0;
+        double analysisNs = 0.0, worstAnalysisNs = 0.0;
+        int numFrames = 0;
+        int collectAllocations = 0;
+        volatile float sink = 0.0f;
+
+        const int total = static_cast<int>(input.size());
+        for (int blockStart = 0; blockStart < total; blockStart += hostBlockSize)
+        {
+            const int blockLength = juce::jmin(hostBlockSize, total - blockStart);
+            int framesInBlock = 0;
+
+            // Collection side, split at hop boundaries exactly like processBlock
+            const int allocationsBefore = checkedAllocations.load(std::memory_order_relaxed);
+            const auto callbackStart = Clock::now();
+            {
+                ScopedAllocationCheck allocationCheck;
+
+                for (int offset = 0; offset < blockLength;)
+                {
+                    const int chunk = juce::jmin(blockLength - offset, engine.getSamplesUntilNextHop());
+
+                    if (engine.collect(input.data() + blockStart + offset, chunk))
+                    {
+                        engine.takeSnapshot(snapshot);
+                        ++framesInBlock;
+                    }
+
+                    offset += chunk;
+                }
+            }
+
+            const double callbackNs = elapsedNs(callbackStart);
+            collectAllocations += checkedAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+            collectNs += callbackNs;
+            worstCallbackNs = juce::jmax(worstCallbackNs, callbackNs);
+
+            // Analysis side (hops are longer than a host block, so at most one frame per block)
+            if (framesInBlock > 0)
+            {
+                const auto analysisStart = Clock::now();
+                sink = engine.analyse(snapshot).frequency;
+                const double frameNs = elapsedNs(analysisStart);
+
+                analysisNs += frameNs;
+                worstAnalysisNs = juce::jmax(worstAnalysisNs, frameNs);
+                ++numFrames;
+            }
+        }
+
+        juce::ignoreUnused(sink);
+        const auto stats = engine.getSchedulingStats();
+        const auto detectorStats = engine.getDetectorStats(options.detector);
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("bufferSize", bufferSize);
+        result->setProperty("updatesPerSecond", updatesPerSecond);
+        result->setProperty("detector", detectorName(options.detector, multiResolution));
+        result->setProperty("collectNsPerSample", collectNs / total);
+        result->setProperty("worstCallbackUs", worstCallbackNs / 1000.0);
+        result->setProperty("collectAllocations", collectAllocations);
+        result->setProperty("analysisNsPerSample", analysisNs / total);
+        result->setProperty("analysisUsPerFrame", numFrames > 0 ? analysisNs / numFrames / 1000.0 : 0.0);
+        result->setProperty("worstAnalysisUs", worstAnalysisNs / 1000.0);
+        result->setProperty("totalNsPerSample", (collectNs + analysisNs) / total);
+        result->setProperty("realtimeLoadPercent", 100.0 * (collectNs + analysisNs) / (seconds * 1.0e9));
+        result->setProperty("fullPasses", stats.fullPasses);
+        result->setProperty("verifiedFrames", stats.verifiedFrames);
+        result->setProperty("skippedFrames", stats.skippedFrames);
+        result->setProperty("onsetHops", stats.onsetHops);
+        result->setProperty("detectorUsPerFrame", multiResolution ? 0.0 : detectorStats.meanMicroseconds);
+        return juce::var(result);
+    }
+
+    //==============================================================================
+    struct AccuracyStats
+    {
+        int numFrames = 0;
+        int numGrossErrors = 0;
+        double sumSquaredCents = 0.0;
+        int numScored = 0;
+        double sumConfidence = 0.0;
+
+        void add(double expected, float detected, float confidence = 0.0f)
+        {
+            ++numFrames;
+            sumConfidence += confidence;
+
+            if (detected <= 0.0f)
+            {
+                ++numGrossErrors;
+                return;
+            }
+
+            const double cents = 1200.0 * std::log2(detected / expected);
+            if (std::abs(cents) > grossErrorCents)
+            {
+                ++numGrossErrors;
+                return;
+            }
+
+            sumSquaredCents += cents * cents;
+            ++numScored;
+        }
+
+        double grossErrorRate() const { return numFrames > 0 ? static_cast<double>(numGrossErrors) / numFrames : 0.0; }
+        double centsRmse() const { return numScored > 0 ? std::sqrt(sumSquaredCents / numScored) : 0.0; }
+        double meanConfidence() const { return numFrames > 0 ? sumConfidence / numFrames : 0.0; }
+    };
+
+    juce::var runAccuracy(const EngineOptions& options, double sampleRate, int bufferSize, bool multiResolution, Signal signal)
+    {
+        constexpr int framesPerNote = 4;
+        const int hopSize = hopSizeFor(sampleRate, 20);
+
+        PitchDetectionEngine::Snapshot snapshot;
+        AccuracyStats overall;
+        std::vector<juce::var> perNote;
+
+        // Enough audio to fill the window and the band-split detector's longest band, then a few hops
+        std::vector<float> input(static_cast<size_t>(juce::jmax(bufferSize, static_cast<int>(sampleRate * 0.2)) + framesPerNote * hopSize));
+
+        for (int note = firstNote; note <= lastNote; ++note)
+        {
+            const double frequency = 440.0 * std::pow(2.0, (note - 69) / 12.0);
+            generateTone(input, sampleRate, frequency, signal);
+
+            // Fresh engine per note so earlier notes cannot leak into the window
+            PitchDetectionEngine engine;
+            engine.setDifferenceMethod(options.method);
+            engine.setDetector(options.detector);
+            engine.setAdaptiveScheduling(options.adaptive);
+            engine.setPitchTracking(options.tracking);
+            engine.setMultiResolution(multiResolution);
+            engine.prepare(sampleRate, bufferSize, hopSize);
+            engine.prepareSnapshot(snapshot);
+
+            AccuracyStats noteStats;
+            const int skip = static_cast<int>(input.size()) - framesPerNote * hopSize;
+
+            engine.processOffline(input.data(), static_cast<int>(input.size()), snapshot,
+                [&](const PitchDetectionEngine::Snapshot& frame, const PitchDetectionEngine::Result& result)
+                {
+                    // Only score frames once the detector has seen a full window of the tone
+                    if (frame.endSamplePosition > skip)
+                    {
+                        noteStats.add(frequency, result.frequency, result.confidence);
+                        overall.add(frequency, result.frequency, result.confidence);
+                    }
+                });
+
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("note", note);
+            entry->setProperty("grossErrorRate", noteStats.grossErrorRate());
+            entry->setProperty("centsRmse", noteStats.centsRmse());
+            perNote.push_back(juce::var(entry));
+        }
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("bufferSize", bufferSize);
+        result->setProperty("detector", detectorName(options.detector, multiResolution));
+        result->setProperty("signal", signal == Signal::sine ? "sine" : "harmonic");
+        result->setProperty("frames", overall.numFrames);
+        result->setProperty("grossErrorRate", overall.grossErrorRate());
+        result->setProperty("centsRmse", overall.centsRmse());
+        result->setProperty("meanConfidence", overall.meanConfidence());
+        result->setProperty("notes", juce::var(perNote));
+        return juce::var(result);
+    }
+
+    //==============================================================================
+    template <typename Policy>
+    juce::var runAccumulation(double sampleRate, int bufferSize)
+    {
+        using Core = YinCore<Policy>;
+        using Reference = YinCore<Accumulation::Double>;
+
+        const int numLags = bufferSize / 2;
+        const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0));
+        const int maxTau = juce::jmin(numLags - 2, static_cast<int>(sampleRate / 70.0));
+
+        std::vector<float> input(static_cast<size_t>(bufferSize));
+        std::vector<float> curve(static_cast<size_t>(numLags)), reference(static_cast<size_t>(numLags));
+
+        AccuracyStats stats;
+        double totalNs = 0.0, maxDeviation = 0.0;
+        int numFrames = 0;
+
+        // One note per octave inside the search range (70 Hz to 1200 Hz)
+        for (int note = 38; note <= 86; note += 12)
+        {
+            const double frequency = 440.0 * std::pow(2.0, (note - 69) / 12.0);
+            generateTone(input, sampleRate, frequency, Signal::harmonic);
+
+            const auto start = Clock::now();
+            Core::differenceDirect(input.data(), bufferSize, curve.data(), numLags);
+            Core::cumulativeMeanNormalise(curve.data(), numLags);
+            const float tau = Core::findPeriod(curve.data(), numLags, minTau, maxTau, 0.15f);
+            totalNs += elapsedNs(start);
+            ++numFrames;
+
+            stats.add(frequency, tau > 0.0f ? static_cast<float>(sampleRate / tau) : 0.0f);
+
+            Reference::differenceDirect(input.data(), bufferSize, reference.data(), numLags);
+            Reference::cumulativeMeanNormalise(reference.data(), numLags);
+
+            for (int lag = 1; lag < numLags; ++lag)
+                maxDeviation = juce::jmax(maxDeviation, static_cast<double>(std::abs(curve[static_cast<size_t>(lag)] - reference[static_cast<size_t>(lag)])));
+        }
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("accumulation", Policy::name);
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("bufferSize", bufferSize);
+        result->setProperty("usPerFrame", totalNs / numFrames / 1000.0);
+        result->setProperty("grossErrorRate", stats.grossErrorRate());
+        result->setProperty("centsRmse", stats.centsRmse());
+        result->setProperty("maxCmndDeviationFromDouble", maxDeviation);
+        return juce::var(result);
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: PitchBenchmarks [options]\n"
+                     "  --method=fft|direct|incremental   YIN difference function (default fft)\n"
+                     "  --detector=NAME                   single-pitch detector: yin (default), mpm, swipe or perceptual\n"
+                     "  --adaptive                        skip silent frames, verify steady ones, early hops on onsets\n"
+                     "  --tracking                        HMM-smoothed tracking around the previous period\n"
+                     "  --sparse                          timing signal alternates half a second of tone and silence\n"
+                     "  --seconds=N                       audio per timing run (default 5)\n"
+                     "  --timing-only | --accuracy-only\n"
+                     "  --quick                           44.1/48 kHz and 4096/8192 only\n"
+                     "  --accumulation                    float vs double vs pairwise YIN core on long windows\n"
+                     "  --selftest                        check the SIMD kernels against the scalar ones, exit 1 on failure\n"
+                     "  --output=FILE                     write the JSON report here instead of stdout\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption("--selftest"))
+    {
+        const bool passed = SimdKernels::runSelfTest();
+        std::cout << "SIMD self-test " << (passed ? "passed" : "FAILED") << " (best available: "
+                  << SimdKernels::getInstructionSetName(SimdKernels::getBestAvailableInstructionSet()) << ")\n";
+        return passed ? 0 : 1;
+    }
+
+    EngineOptions options;
+    const auto methodName = args.containsOption("--method") ? args.getValueForOption("--method") : juce::String("fft");
+    if (methodName == "direct")
+        options.method = DifferenceMethod::direct;
+    else if (methodName == "incremental")
+        options.method = DifferenceMethod::incremental;
+
+    const auto detectorOption = args.containsOption("--detector") ? args.getValueForOption("--detector") : juce::String("yin");
+    if (detectorOption == "mpm")
+        options.detector = Detector::mpm;
+    else if (detectorOption == "swipe")
+        options.detector = Detector::swipe;
+    else if (detectorOption == "perceptual")
+        options.detector = Detector::perceptual;
+
+    options.adaptive = args.containsOption("--adaptive");
+    options.tracking = args.containsOption("--tracking");
+    options.sparse = args.containsOption("--sparse");
+
+    const double seconds = args.containsOption("--seconds") ? juce::jmax(1.0, args.getValueForOption("--seconds").getDoubleValue()) : 5.0;
+    const bool quick = args.containsOption("--quick");
+    const bool doTiming = !args.containsOption("--accuracy-only");
+    const bool doAccuracy = !args.containsOption("--timing-only");
+
+    auto includeRate = [quick](double sr) { return !quick || sr == 44100.0 || sr == 48000.0; };
+    auto includeSize = [quick](int size) { return !quick || size == 4096 || size == 8192; };
+
+    if (args.containsOption("--accumulation"))
+    {
+        std::vector<juce::var> results;
+
+        for (const double sampleRate : { 48000.0, 192000.0 })
+            for (const int bufferSize : { 8192, 16384 })
+            {
+                results.push_back(runAccumulation<Accumulation::Float>(sampleRate, bufferSize));
+                results.push_back(runAccumulation<Accumulation::Pairwise>(sampleRate, bufferSize));
+                results.push_back(runAccumulation<Accumulation::Double>(sampleRate, bufferSize));
+                std::cerr << sampleRate << " Hz, " << bufferSize << " done\n";
+            }
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty("instructionSet", SimdKernels::getInstructionSetName(SimdKernels::getInstructionSet()));
+        report->setProperty("accumulation", juce::var(results));
+
+        const auto json = juce::JSON::toString(juce::var(report));
+
+        if (args.containsOption("--output"))
+            return args.getFileForOption("--output").replaceWithText(json) ? 0 : 1;
+
+        std::cout << json << "\n";
+        return 0;
+    }
+
+    std::vector<juce::var> timing, accuracy;
+
+    for (const double sampleRate : sampleRates)
+    {
+        if (!includeRate(sampleRate))
+            continue;
+
+        for (const int bufferSize : bufferSizes)
+        {
+            if (!includeSize(bufferSize))
+                continue;
+
+            for (const bool multiResolution : { false, true })
+            {
+                if (doTiming)
+                    for (const int rate : updateRates)
+                        timing.push_back(runTiming(options, sampleRate, bufferSize, rate, multiResolution, seconds));
+
+                if (doAccuracy)
+                    for (const auto signal : { Signal::sine, Signal::harmonic })
+                        accuracy.push_back(runAccuracy(options, sampleRate, bufferSize, multiResolution, signal));
+
+                std::cerr << sampleRate << " Hz, " << bufferSize << (multiResolution ? " (multi-res)" : "") << " done\n";
+            }
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("method", methodName);
+    report->setProperty("detector", detectorName(options.detector, false));
+    report->setProperty("adaptive", options.adaptive);
+    report->setProperty("tracking", options.tracking);
+    report->setProperty("sparse", options.sparse);
+    report->setProperty("instructionSet", SimdKernels::getInstructionSetName(SimdKernels::getInstructionSet()));
+    report->setProperty("hostBlockSize", hostBlockSize);
+    report->setProperty("timing", juce::var(timing));
+    report->setProperty("accuracy", juce::var(accuracy));
+
+    const auto json = juce::JSON::toString(juce::var(report));
+    const int allocations = checkedAllocations.load(std::memory_order_relaxed);
+
+    if (allocations > 0)
+        std::cerr << "The collection side allocated " << allocations << " times\n";
+
+    if (args.containsOption("--output"))
+        return args.getFileForOption("--output").replaceWithText(json) && allocations == 0 ? 0 : 1;
+
+    std::cout << json << "\n";
+    return allocations == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "DiagnosticsOverlay.h"
+#include "PluginProcessor.h"
+
+#if PITCHDETECTOR_INSTRUMENTATION
+
+namespace
+{
+    constexpr double updateIntervalMs = 250.0;
+    constexpr int rowHeight = 14;
+    constexpr int nameWidth = 100;
+    constexpr int valueWidth = 75;
+}
+
+DiagnosticsOverlay::DiagnosticsOverlay(PitchDetectorAudioProcessor& p)
+    : audioProcessor(p)
+{
+    addAndMakeVisible(resetButton);
+    resetButton.setButtonText("Reset");
+    resetButton.onClick = [this]()
+        {
+            audioProcessor.resetInstrumentation();
+            lastUpdateMs = 0.0;
+            update();
+        };
+
+    addAndMakeVisible(saveButton);
+    saveButton.setButtonText("Save...");
+    saveButton.onClick = [this]()
+        {
+            saveReport();
+        };
+}
+
+void DiagnosticsOverlay::update()
+{
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    if (lastUpdateMs > 0.0 && nowMs - lastUpdateMs < updateIntervalMs)
+        return;
+
+    previousReport = report;
+    report = audioProcessor.getInstrumentationReport();
+    intervalSeconds = lastUpdateMs > 0.0 ? (nowMs - lastUpdateMs) / 1000.0 : 0.0;
+    lastUpdateMs = nowMs;
+
+    repaint();
+}
+
+double DiagnosticsOverlay::getRate(Instrumentation::Stage stage) const
+{
+    // Straight after a reset the counts go backwards; show nothing until the next report
+    const auto calls = report[stage].calls - previousReport[stage].calls;
+    return intervalSeconds > 0.0 && calls >= 0 ? static_cast<double>(calls) / intervalSeconds : 0.0;
+}
+
+void DiagnosticsOverlay::resized()
+{
+    auto buttons = getLocalBounds().reduced(6).removeFromTop(20).removeFromRight(150);
+    saveButton.setBounds(buttons.removeFromRight(70));
+    buttons.removeFromRight(10);
+    resetButton.setBounds(buttons.removeFromRight(70));
+}
+
+void DiagnosticsOverlay::paint(juce::Graphics& g)
+{
+    using Instrumentation::Stage;
+
+    g.fillAll(juce::Colour(0xf00a0a0a));
+    g.setColour(juce::Colours::grey);
+    g.drawRect(getLocalBounds(), 1);
+
+    g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+
+    int y = 6;
+    auto drawRow = [&](const juce::String& name, const juce::StringArray& values)
+        {
+            g.drawText(name, 8, y, nameWidth, rowHeight, juce::Justification::left);
+
+            for (int i = 0; i < values.size(); ++i)
+                g.drawText(values[i], 8 + nameWidth + i * valueWidth, y, valueWidth, rowHeight, juce::Justification::right);
+
+            y += rowHeight;
+        };
+
+    g.setColour(juce::Colours::lightgrey);
+    drawRow("Stage", { "calls/s", "mean us", "p99 us", "max us" });
+
+    for (int s = 0; s < Instrumentation::numStages; ++s)
+    {
+        const auto stage = static_cast<Stage>(s);
+        const auto& stats = report[stage];
+
+        g.setColour(juce::Colours::white);
+        drawRow(Instrumentation::getStageName(stage),
+                { juce::String(getRate(stage), 1), juce::String(stats.getMeanMicroseconds(), 1),
+                  juce::String(stats.getPercentileMicroseconds(0.99), 0), juce::String(stats.maxMicroseconds, 1) });
+    }
+
+    // Worst callback against its deadline, then the counts of work that didn't happen
+    y += rowHeight / 2;
+    g.setColour(report.maxCallbackLoad > 0.5 || report.callbackOverruns > 0 ? juce::Colours::orange : juce::Colours::lightgreen);
+    g.drawText("Callback load: max " + juce::String(report.maxCallbackLoad * 100.0, 1) + "% of buffer, "
+                   + juce::String(report.callbackOverruns) + " overruns    Analyses/s: " + juce::String(getRate(Stage::analysis), 1),
+               8, y, getWidth() - 16, rowHeight, juce::Justification::left);
+    y += rowHeight;
+
+    g.setColour(juce::Colours::lightgrey);
+    g.drawText("Dropped hops: " + juce::String(report.droppedHops) + "    Silent frames: " + juce::String(report.silentFrames)
+                   + "    Log queue: " + juce::String(report.logQueueDepth) + " (max " + juce::String(report.maxLogQueueDepth)
+                   + ", " + juce::String(report.droppedPitchEvents) + " dropped)",
+               8, y, getWidth() - 16, rowHeight, juce::Justification::left);
+    y += rowHeight;
+
+    g.drawText("Analysis queue: mean " + juce::String(report.meanQueueLatencyMs, 2) + " ms, max "
+                   + juce::String(report.maxQueueLatencyMs, 2) + " ms",
+               8, y, getWidth() - 16, rowHeight, juce::Justification::left);
+}
+
+void DiagnosticsOverlay::saveReport()
+{
+    saveChooser = std::make_unique<juce::FileChooser>("Save diagnostics",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("PitchDetectorDiagnostics.csv"), "*.csv;*.json");
+
+    const int flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                    | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    saveChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            // A fresh report, so the file matches the moment it was saved
+            const auto current = audioProcessor.getInstrumentationReport();
+            const bool json = file.hasFileExtension("json");
+
+            if (!file.replaceWithText(json ? Instrumentation::toJson(current) : Instrumentation::toCsv(current)))
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Save diagnostics",
+                    "Could not write " + file.getFullPathName());
+        });
+}
+
+#endif
\ No newline at end of file
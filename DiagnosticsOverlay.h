@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Instrumentation.h"
+
+#if PITCHDETECTOR_INSTRUMENTATION
+
+class PitchDetectorAudioProcessor;
+
+// Stage timings and load counters, shown over the pitch graph in instrumented builds
+//
+// update() takes a report from the processor a few times a second. Rates are measured between
+// consecutive reports, so they show the current load rather than the average since the reset;
+// the timings and histograms cover everything since the reset.
+class DiagnosticsOverlay : public juce::Component
+{
+public:
+    explicit DiagnosticsOverlay(PitchDetectorAudioProcessor& processor);
+
+    // Call from the editor's timer while visible
+    void update();
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    double getRate(Instrumentation::Stage stage) const;
+    void saveReport();
+
+    PitchDetectorAudioProcessor& audioProcessor;
+
+    Instrumentation::Report report, previousReport;
+    double lastUpdateMs = 0.0;
+    double intervalSeconds = 0.0;    // between previousReport and report
+
+    juce::TextButton resetButton;
+    juce::TextButton saveButton;
+    std::unique_ptr<juce::FileChooser> saveChooser;
+
+    JUCE_DECLARE_NON_COPYABLE(DiagnosticsOverlay)
+};
+
+#endif
\ No newline at end of file
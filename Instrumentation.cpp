@@ -0,0 +1,221 @@
+#include "Instrumentation.h"
+
+#if PITCHDETECTOR_INSTRUMENTATION
+
+namespace Instrumentation
+{
+    namespace
+    {
+        constexpr const char* stageNames[numStages] = { "processBlock", "collect", "snapshot", "analysis", "detect", "noteMapping" };
+
+        void updateMax(std::atomic<juce::int64>& target, juce::int64 value) noexcept
+        {
+            auto current = target.load(std::memory_order_relaxed);
+            while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        int getHistogramBin(juce::int64 microseconds) noexcept
+        {
+            int bin = 0;
+            for (; microseconds > 0 && bin < numHistogramBins - 1; microseconds >>= 1)
+                ++bin;
+
+            return bin;
+        }
+
+        double getBinUpperEdge(int bin)
+        {
+            return static_cast<double>(juce::int64{ 1 } << bin);
+        }
+    }
+
+    const char* getStageName(Stage stage) noexcept
+    {
+        return stageNames[static_cast<size_t>(stage)];
+    }
+
+    double StageStats::getPercentileMicroseconds(double fraction) const
+    {
+        if (calls == 0)
+            return 0.0;
+
+        const auto target = static_cast<juce::int64>(std::ceil(fraction * static_cast<double>(calls)));
+        juce::int64 counted = 0;
+
+        for (int bin = 0; bin < numHistogramBins - 1; ++bin)
+        {
+            counted += histogram[static_cast<size_t>(bin)];
+            if (counted >= target)
+                return juce::jmin(getBinUpperEdge(bin), maxMicroseconds);
+        }
+
+        return maxMicroseconds;
+    }
+
+    //==============================================================================
+    Counters::Counters()
+        : ticksPerMicrosecond(static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) / 1.0e6)
+    {
+        reset();
+    }
+
+    void Counters::record(Stage stage, juce::int64 startTicks, juce::int64 endTicks) noexcept
+    {
+        auto& counters = stages[static_cast<size_t>(stage)];
+        const auto ticks = endTicks - startTicks;
+
+        counters.calls.fetch_add(1, std::memory_order_relaxed);
+        counters.totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+        updateMax(counters.maxTicks, ticks);
+
+        const auto microseconds = static_cast<juce::int64>(static_cast<double>(ticks) / ticksPerMicrosecond);
+        counters.histogram[static_cast<size_t>(getHistogramBin(microseconds))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Counters::recordCallback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept
+    {
+        record(Stage::processBlock, startTicks, endTicks);
+
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return;
+
+        const double budgetMicroseconds = 1.0e6 * numSamples / sampleRate;
+        const double load = static_cast<double>(endTicks - startTicks) / ticksPerMicrosecond / budgetMicroseconds;
+
+        updateMax(maxCallbackLoadPpm, static_cast<juce::int64>(load * 1.0e6));
+
+        if (load > 1.0)
+            callbackOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Counters::recordLogQueueDepth(int depth) noexcept
+    {
+        logQueueDepth.store(depth, std::memory_order_relaxed);
+
+        if (depth > maxLogQueueDepth.load(std::memory_order_relaxed))
+            maxLogQueueDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    void Counters::reset() noexcept
+    {
+        for (auto& counters : stages)
+        {
+            counters.calls.store(0, std::memory_order_relaxed);
+            counters.totalTicks.store(0, std::memory_order_relaxed);
+            counters.maxTicks.store(0, std::memory_order_relaxed);
+
+            for (auto& bin : counters.histogram)
+                bin.store(0, std::memory_order_relaxed);
+        }
+
+        maxCallbackLoadPpm.store(0, std::memory_order_relaxed);
+        callbackOverruns.store(0, std::memory_order_relaxed);
+        maxLogQueueDepth.store(0, std::memory_order_relaxed);
+        resetTicks.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+    }
+
+    Report Counters::getReport() const
+    {
+        Report report;
+        report.elapsedSeconds = static_cast<double>(juce::Time::getHighResolutionTicks() - resetTicks.load(std::memory_order_relaxed))
+                              / (ticksPerMicrosecond * 1.0e6);
+
+        for (size_t s = 0; s < stages.size(); ++s)
+        {
+            const auto& counters = stages[s];
+            auto& stats = report.stages[s];
+
+            stats.calls = counters.calls.load(std::memory_order_relaxed);
+            stats.totalMicroseconds = static_cast<double>(counters.totalTicks.load(std::memory_order_relaxed)) / ticksPerMicrosecond;
+            stats.maxMicroseconds = static_cast<double>(counters.maxTicks.load(std::memory_order_relaxed)) / ticksPerMicrosecond;
+
+            for (size_t bin = 0; bin < stats.histogram.size(); ++bin)
+                stats.histogram[bin] = counters.histogram[bin].load(std::memory_order_relaxed);
+        }
+
+        report.maxCallbackLoad = static_cast<double>(maxCallbackLoadPpm.load(std::memory_order_relaxed)) / 1.0e6;
+        report.callbackOverruns = callbackOverruns.load(std::memory_order_relaxed);
+        report.logQueueDepth = logQueueDepth.load(std::memory_order_relaxed);
+        report.maxLogQueueDepth = maxLogQueueDepth.load(std::memory_order_relaxed);
+        return report;
+    }
+
+    //==============================================================================
+    juce::String toCsv(const Report& report)
+    {
+        juce::String csv;
+        csv << "stage,calls,calls_per_s,mean_us,p99_us,max_us";
+        for (int bin = 0; bin < numHistogramBins; ++bin)
+            csv << (bin < numHistogramBins - 1 ? ",under_" + juce::String(juce::int64{ 1 } << bin) : ",over_" + juce::String(juce::int64{ 1 } << (bin - 1))) << "us";
+        csv << "\n";
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            const auto& stats = report.stages[static_cast<size_t>(s)];
+            csv << getStageName(static_cast<Stage>(s)) << "," << stats.calls << ","
+                << juce::String(stats.calls / juce::jmax(1.0e-9, report.elapsedSeconds), 2) << ","
+                << juce::String(stats.getMeanMicroseconds(), 2) << "," << juce::String(stats.getPercentileMicroseconds(0.99), 2) << ","
+                << juce::String(stats.maxMicroseconds, 2);
+
+            for (auto count : stats.histogram)
+                csv << "," << count;
+
+            csv << "\n";
+        }
+
+        // Scalar counters as name,value rows after a blank line
+        csv << "\ncounter,value\n"
+            << "elapsed_s," << juce::String(report.elapsedSeconds, 3) << "\n"
+            << "max_callback_load," << juce::String(report.maxCallbackLoad, 4) << "\n"
+            << "callback_overruns," << report.callbackOverruns << "\n"
+            << "dropped_hops," << report.droppedHops << "\n"
+            << "silent_frames," << report.silentFrames << "\n"
+            << "dropped_pitch_events," << report.droppedPitchEvents << "\n"
+            << "log_queue_depth," << report.logQueueDepth << "\n"
+            << "max_log_queue_depth," << report.maxLogQueueDepth << "\n"
+            << "mean_queue_latency_ms," << juce::String(report.meanQueueLatencyMs, 3) << "\n"
+            << "max_queue_latency_ms," << juce::String(report.maxQueueLatencyMs, 3) << "\n";
+
+        return csv;
+    }
+
+    juce::String toJson(const Report& report)
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty("elapsedSeconds", report.elapsedSeconds);
+        root->setProperty("maxCallbackLoad", report.maxCallbackLoad);
+        root->setProperty("callbackOverruns", report.callbackOverruns);
+        root->setProperty("droppedHops", report.droppedHops);
+        root->setProperty("silentFrames", report.silentFrames);
+        root->setProperty("droppedPitchEvents", report.droppedPitchEvents);
+        root->setProperty("logQueueDepth", report.logQueueDepth);
+        root->setProperty("maxLogQueueDepth", report.maxLogQueueDepth);
+        root->setProperty("meanQueueLatencyMs", report.meanQueueLatencyMs);
+        root->setProperty("maxQueueLatencyMs", report.maxQueueLatencyMs);
+
+        auto* stageObjects = new juce::DynamicObject();
+        for (int s = 0; s < numStages; ++s)
+        {
+            const auto& stats = report.stages[static_cast<size_t>(s)];
+            auto* stage = new juce::DynamicObject();
+            stage->setProperty("calls", stats.calls);
+            stage->setProperty("meanMicroseconds", stats.getMeanMicroseconds());
+            stage->setProperty("p99Microseconds", stats.getPercentileMicroseconds(0.99));
+            stage->setProperty("maxMicroseconds", stats.maxMicroseconds);
+
+            juce::Array<juce::var> histogram;
+            for (auto count : stats.histogram)
+                histogram.add(count);
+
+            stage->setProperty("histogramLog2Microseconds", histogram);
+            stageObjects->setProperty(getStageName(static_cast<Stage>(s)), juce::var(stage));
+        }
+
+        root->setProperty("stages", juce::var(stageObjects));
+        return juce::JSON::toString(juce::var(root));
+    }
+}
+
+#endif
\ No newline at end of file
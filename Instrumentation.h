@@ -0,0 +1,144 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// Hot-path timing and load counters
+//
+// PITCHDETECTOR_INSTRUMENTATION enables them (debug builds by default). Each stage keeps a call
+// count, total and worst time and a log2 histogram in relaxed atomics, so recording costs two
+// high-resolution clock reads and a few uncontended adds on the thread that ran the stage.
+// Readers take a Report whenever they like. With the flag off, the PITCHDETECTOR_TIME_* macros
+// expand to nothing and none of this is compiled.
+#ifndef PITCHDETECTOR_INSTRUMENTATION
+ #define PITCHDETECTOR_INSTRUMENTATION JUCE_DEBUG
+#endif
+
+#if PITCHDETECTOR_INSTRUMENTATION
+
+namespace Instrumentation
+{
+    enum class Stage
+    {
+        processBlock,   // whole audio callback
+        collect,        // samples into the circular analysis window
+        snapshot,       // window copy handed to the analysis thread
+        analysis,       // one hop on the analysis thread, all channels
+        detect,         // difference function and period pick, one channel
+        noteMapping,    // frequency to note name and cents
+        numStages
+    };
+
+    constexpr int numStages = static_cast<int>(Stage::numStages);
+
+    // Bin 0 counts calls under 1 us, bin b calls of [2^(b-1), 2^b) us; the last bin is open-ended
+    constexpr int numHistogramBins = 16;
+
+    const char* getStageName(Stage stage) noexcept;
+
+    struct StageStats
+    {
+        juce::int64 calls = 0;
+        double totalMicroseconds = 0.0;
+        double maxMicroseconds = 0.0;
+        std::array<juce::int64, numHistogramBins> histogram{};
+
+        double getMeanMicroseconds() const { return calls > 0 ? totalMicroseconds / static_cast<double>(calls) : 0.0; }
+
+        // Upper edge of the histogram bin holding the given fraction of calls
+        double getPercentileMicroseconds(double fraction) const;
+    };
+
+    struct Report
+    {
+        double elapsedSeconds = 0.0;            // since the counters were reset
+        std::array<StageStats, numStages> stages;
+
+        double maxCallbackLoad = 0.0;           // worst callback time over its buffer's duration
+        juce::int64 callbackOverruns = 0;       // callbacks that took longer than their buffer lasts
+
+        // Filled in by the processor
+        int droppedHops = 0;                    // analysis thread had not caught up
+        int silentFrames = 0;                   // skipped by adaptive scheduling
+        int droppedPitchEvents = 0;
+        int logQueueDepth = 0;                  // at the last push
+        int maxLogQueueDepth = 0;
+        double meanQueueLatencyMs = 0.0;        // hop ready to analysis started, in the shared service
+        double maxQueueLatencyMs = 0.0;
+
+        const StageStats& operator[](Stage stage) const { return stages[static_cast<size_t>(stage)]; }
+    };
+
+    juce::String toCsv(const Report& report);
+    juce::String toJson(const Report& report);
+
+    class Counters
+    {
+    public:
+        Counters();
+
+        void record(Stage stage, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+        void recordCallback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept;
+        void recordLogQueueDepth(int depth) noexcept;
+
+        // Counts from threads still inside a stage may land on either side of a reset
+        void reset() noexcept;
+
+        Report getReport() const;
+
+    private:
+        struct StageCounters
+        {
+            std::atomic<juce::int64> calls{ 0 };
+            std::atomic<juce::int64> totalTicks{ 0 };
+            std::atomic<juce::int64> maxTicks{ 0 };
+            std::array<std::atomic<juce::int64>, numHistogramBins> histogram{};
+        };
+
+        std::array<StageCounters, numStages> stages;
+        std::atomic<juce::int64> maxCallbackLoadPpm{ 0 };
+        std::atomic<juce::int64> callbackOverruns{ 0 };
+        std::atomic<int> logQueueDepth{ 0 };
+        std::atomic<int> maxLogQueueDepth{ 0 };
+        std::atomic<juce::int64> resetTicks{ 0 };
+
+        const double ticksPerMicrosecond;
+
+        JUCE_DECLARE_NON_COPYABLE(Counters)
+    };
+
+    struct ScopedStageTimer
+    {
+        ScopedStageTimer(Counters& c, Stage s) noexcept : counters(c), stage(s), startTicks(juce::Time::getHighResolutionTicks()) {}
+        ~ScopedStageTimer() noexcept { counters.record(stage, startTicks, juce::Time::getHighResolutionTicks()); }
+
+        Counters& counters;
+        const Stage stage;
+        const juce::int64 startTicks;
+    };
+
+    // Times the whole callback and its load against the buffer's duration
+    struct ScopedCallbackTimer
+    {
+        ScopedCallbackTimer(Counters& c, int n, double sr) noexcept : counters(c), numSamples(n), sampleRate(sr), startTicks(juce::Time::getHighResolutionTicks()) {}
+        ~ScopedCallbackTimer() noexcept { counters.recordCallback(startTicks, juce::Time::getHighResolutionTicks(), numSamples, sampleRate); }
+
+        Counters& counters;
+        const int numSamples;
+        const double sampleRate;
+        const juce::int64 startTicks;
+    };
+}
+
+ #define PITCHDETECTOR_TIME_STAGE(counters, stage) \
+    const Instrumentation::ScopedStageTimer JUCE_JOIN_MACRO(stageTimer, __LINE__)((counters), Instrumentation::Stage::stage)
+
+ #define PITCHDETECTOR_TIME_CALLBACK(counters, numSamples, sampleRate) \
+    const Instrumentation::ScopedCallbackTimer JUCE_JOIN_MACRO(callbackTimer, __LINE__)((counters), (numSamples), (sampleRate))
+
+#else
+
+ #define PITCHDETECTOR_TIME_STAGE(counters, stage)
+ #define PITCHDETECTOR_TIME_CALLBACK(counters, numSamples, sampleRate)
+
+#endif
\ No newline at end of file
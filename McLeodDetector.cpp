@@ -0,0 +1,141 @@
+#include "McLeodDetector.h"
+
+namespace
+{
+    // Same search range as the engine's YIN
+    constexpr double minFrequency = 70.0;
+    constexpr double maxFrequency = 1200.0;
+}
+
+int McLeodDetector::fftOrderFor(int length)
+{
+    return juce::findHighestSetBit(static_cast<juce::uint32>(juce::nextPowerOfTwo(length + length / 2)));
+}
+
+void McLeodDetector::prepare(double newSampleRate, int minFrameLength, int maxFrameLength)
+{
+    sampleRate = newSampleRate;
+    minOrder = fftOrderFor(minFrameLength);
+
+    ffts.clear();
+    for (int order = minOrder; order <= fftOrderFor(maxFrameLength); ++order)
+        ffts.push_back(std::make_unique<juce::dsp::FFT>(order));
+
+    workspace.assign(static_cast<size_t>(ffts.back()->getSize()) * 2, 0.0f);
+    energyPrefix.assign(static_cast<size_t>(maxFrameLength) + 1, 0.0);
+    nsdf.assign(static_cast<size_t>(maxFrameLength / 2), 0.0f);
+
+    setFrameLength(maxFrameLength);
+}
+
+void McLeodDetector::setFrameLength(int newFrameLength)
+{
+    frameLength = newFrameLength;
+    fft = ffts[static_cast<size_t>(fftOrderFor(frameLength) - minOrder)].get();
+
+    minTau = juce::jmax(4, static_cast<int>(sampleRate / maxFrequency));
+    maxTau = juce::jmin(frameLength / 2 - 2, static_cast<int>(sampleRate / minFrequency));
+}
+
+PitchDetector::Estimate McLeodDetector::detect(const float* samples, int numSamples)
+{
+    jassert(numSamples == frameLength);
+
+    Estimate estimate;
+    const int fftSize = fft->getSize();
+    float* work = workspace.data();
+
+    // Autocorrelation from the power spectrum
+    std::copy(samples, samples + numSamples, work);
+    std::fill(work + numSamples, work + fftSize * 2, 0.0f);
+
+    fft->performRealOnlyForwardTransform(work);
+
+    for (int k = 0; k < fftSize; ++k)
+    {
+        const float re = work[2 * k];
+        const float im = work[2 * k + 1];
+        work[2 * k] = re * re + im * im;
+        work[2 * k + 1] = 0.0f;
+    }
+
+    fft->performRealOnlyInverseTransform(work);
+
+    energyPrefix[0] = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+        energyPrefix[i + 1] = energyPrefix[i] + static_cast<double>(samples[i]) * samples[i];
+
+    const double totalEnergy = energyPrefix[numSamples];
+    if (totalEnergy <= 0.0)
+        return estimate;
+
+    const int numLags = maxTau + 2;
+    for (int tau = 0; tau < numLags; ++tau)
+    {
+        const double energy = energyPrefix[numSamples - tau] + (totalEnergy - energyPrefix[tau]);
+        nsdf[tau] = energy > 0.0 ? static_cast<float>(2.0 * work[tau] / energy) : 0.0f;
+    }
+
+    // Calls onKeyMaximum(tau) for the highest point of every positive lobe after the one around lag 0
+    auto forEachKeyMaximum = [this, numLags](auto&& onKeyMaximum)
+        {
+            int tau = 1;
+            while (tau < numLags && nsdf[tau] > 0.0f)
+                ++tau;
+
+            while (tau < numLags)
+            {
+                while (tau < numLags && nsdf[tau] <= 0.0f)
+                    ++tau;
+
+                int peak = tau;
+                while (tau < numLags && nsdf[tau] > 0.0f)
+                {
+                    if (nsdf[tau] > nsdf[peak])
+                        peak = tau;
+                    ++tau;
+                }
+
+                if (peak >= minTau && peak <= maxTau && peak < numLags && !onKeyMaximum(peak))
+                    return;
+            }
+        };
+
+    float highest = 0.0f;
+    forEachKeyMaximum([this, &highest](int tau) { highest = juce::jmax(highest, nsdf[tau]); return true; });
+
+    if (highest <= 0.0f)
+        return estimate;
+
+    int bestTau = 0;
+    forEachKeyMaximum([this, &bestTau, highest](int tau)
+        {
+            if (nsdf[tau] < clarityRatio * highest)
+                return true;
+
+            bestTau = tau;
+            return false;
+        });
+
+    // Parabolic interpolation of both the lag and the peak height
+    const float s0 = nsdf[bestTau - 1];
+    const float s1 = nsdf[bestTau];
+    const float s2 = nsdf[bestTau + 1];
+
+    float refinedTau = static_cast<float>(bestTau);
+    float peak = s1;
+    const float denom = s0 - 2.0f * s1 + s2;
+    if (std::abs(denom) > 0.0001f)
+    {
+        const float offset = juce::jlimit(-1.0f, 1.0f, 0.5f * (s0 - s2) / denom);
+        refinedTau += offset;
+        peak -= 0.25f * (s0 - s2) * offset;
+    }
+
+    estimate.confidence = juce::jlimit(0.0f, 1.0f, peak);
+
+    if (estimate.confidence >= voicedClarity)
+        estimate.frequency = static_cast<float>(sampleRate / refinedTau);
+
+    return estimate;
+}
\ No newline at end of file
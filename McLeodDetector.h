@@ -0,0 +1,40 @@
+#pragma once
+
+#include "PitchDetector.h"
+
+// McLeod Pitch Method: peak picking on the normalised square difference function
+//
+// NSDF(tau) = 2 r(tau) / m(tau), where r is the autocorrelation (from the power spectrum, as in
+// the engine's FFT difference function) and m the energy of the two overlapping parts. It lies in
+// [-1, 1] with 1 for a perfectly periodic frame. Between each pair of positive-going and
+// negative-going zero crossings the highest point is a key maximum; the first key maximum within
+// clarityRatio of the highest one is the period, which avoids YIN's octave-down errors on strong
+// subharmonics without a fixed absolute threshold. Confidence is the NSDF at that peak. m(tau)
+// already accounts for the shrinking overlap, so the frame is used unwindowed.
+class McLeodDetector : public PitchDetector
+{
+public:
+    const char* getName() const override { return "mpm"; }
+
+    void prepare(double sampleRate, int minFrameLength, int maxFrameLength) override;
+    void setFrameLength(int frameLength) override;
+    Estimate detect(const float* samples, int numSamples) override;
+
+private:
+    static constexpr float clarityRatio = 0.9f;    // of the highest key maximum
+    static constexpr float voicedClarity = 0.6f;   // below this the frame is reported unvoiced
+
+    // Zero-padded so the circular correlation doesn't wrap for any tau < frameLength / 2
+    static int fftOrderFor(int frameLength);
+
+    double sampleRate = 48000.0;
+    int minOrder = 0;
+    int frameLength = 0;
+    int minTau = 0, maxTau = 0;
+
+    std::vector<std::unique_ptr<juce::dsp::FFT>> ffts;  // minOrder upwards
+    const juce::dsp::FFT* fft = nullptr;                 // the one for frameLength
+    std::vector<float> workspace;
+    std::vector<double> energyPrefix;
+    std::vector<float> nsdf;
+};
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "MidiFileExporter.h"
+#include <cmath>
+
+namespace
+{
+    constexpr int pitchBendCentre = 8192;
+}
+
+MidiFileExporter::MidiFileExporter(juce::OutputStream& destination, const Settings& newSettings)
+    : stream(destination), settings(newSettings)
+{
+    settings.ticksPerQuarterNote = juce::jlimit(1, 0x7fff, settings.ticksPerQuarterNote);
+    settings.channel = juce::jlimit(1, 16, settings.channel);
+    settings.pitchBendRangeSemitones = juce::jmax(0.01f, settings.pitchBendRangeSemitones);
+
+    if (settings.bpm <= 0.0)
+        settings.bpm = 120.0;
+
+    writeHeader();
+}
+
+juce::int64 MidiFileExporter::secondsToTicks(double seconds) const
+{
+    // Every event is converted from its absolute time, so rounding never accumulates
+    return std::llround(juce::jmax(0.0, seconds) * settings.bpm / 60.0 * settings.ticksPerQuarterNote);
+}
+
+void MidiFileExporter::writeHeader()
+{
+    stream.write("MThd", 4);
+    stream.writeIntBigEndian(6);
+    stream.writeShortBigEndian(0); // format 0: one track
+    stream.writeShortBigEndian(1);
+    stream.writeShortBigEndian(static_cast<short>(settings.ticksPerQuarterNote));
+
+    stream.write("MTrk", 4);
+    trackLengthPosition = stream.getPosition();
+    stream.writeIntBigEndian(0); // patched in finish()
+    trackStartPosition = stream.getPosition();
+
+    const auto microsecondsPerQuarter = static_cast<juce::uint32>(juce::jlimit(1.0, 16777215.0, std::round(60000000.0 / settings.bpm)));
+    const juce::uint8 tempo[] = { static_cast<juce::uint8>(microsecondsPerQuarter >> 16),
+                                  static_cast<juce::uint8>(microsecondsPerQuarter >> 8),
+                                  static_cast<juce::uint8>(microsecondsPerQuarter) };
+    writeMetaEvent(0, 0x51, tempo, 3);
+
+    const char name[] = "Pitch Detector";
+    writeMetaEvent(0, 0x03, name, static_cast<int>(sizeof(name)) - 1);
+}
+
+void MidiFileExporter::writeVariableLength(juce::uint32 value)
+{
+    juce::uint8 bytes[5];
+    int numBytes = 0;
+
+    bytes[numBytes++] = static_cast<juce::uint8>(value & 0x7f);
+    while ((value >>= 7) != 0)
+        bytes[numBytes++] = static_cast<juce::uint8>((value & 0x7f) | 0x80);
+
+    // Most significant group first
+    while (numBytes > 0)
+        stream.writeByte(static_cast<char>(bytes[--numBytes]));
+}
+
+void MidiFileExporter::writeDelta(juce::int64 tick)
+{
+    tick = juce::jmax(tick, lastTick);
+    writeVariableLength(static_cast<juce::uint32>(juce::jmin(tick - lastTick, static_cast<juce::int64>(0x0fffffff))));
+    lastTick = tick;
+}
+
+void MidiFileExporter::writeChannelMessage(juce::int64 tick, int channel, int status, int data1, int data2)
+{
+    writeDelta(tick);
+    stream.writeByte(static_cast<char>(status | channel));
+    stream.writeByte(static_cast<char>(data1 & 0x7f));
+    stream.writeByte(static_cast<char>(data2 & 0x7f));
+}
+
+void MidiFileExporter::writeMetaEvent(juce::int64 tick, int type, const void* data, int size)
+{
+    writeDelta(tick);
+    stream.writeByte(static_cast<char>(0xff));
+    stream.writeByte(static_cast<char>(type));
+    writeVariableLength(static_cast<juce::uint32>(size));
+
+    if (size > 0)
+        stream.write(data, static_cast<size_t>(size));
+}
+
+void MidiFileExporter::writePitchBend(juce::int64 tick, int channel, const PitchEvent& event)
+{
+    // Offset of the detected frequency from the logged note, as a fraction of the bend range
+    const float cents = 1200.0f * std::log2(event.frequency / 440.0f) + 6900.0f - 100.0f * event.midiNote;
+    const int value = juce::jlimit(0, 16383, pitchBendCentre + juce::roundToInt(cents / (settings.pitchBendRangeSemitones * 100.0f) * pitchBendCentre));
+
+    auto& state = channels[static_cast<size_t>(channel)];
+    if (value == state.lastPitchBend)
+        return;
+
+    writeChannelMessage(tick, channel, 0xe0, value & 0x7f, value >> 7);
+    state.lastPitchBend = value;
+}
+
+void MidiFileExporter::releaseNotes(juce::int64 tick, int channel, bool all)
+{
+    auto& state = channels[static_cast<size_t>(channel)];
+
+    for (int note = 0; note < 128; ++note)
+    {
+        if (state.soundingNotes[note] && (all || state.pendingVelocities[note] == 0))
+        {
+            writeChannelMessage(tick, channel, 0x80, note, 0);
+            state.soundingNotes[note] = false;
+        }
+    }
+}
+
+void MidiFileExporter::flushChord()
+{
+    if (pendingTime < 0.0)
+        return;
+
+    const juce::int64 tick = juce::jmax(lastTick, secondsToTicks(pendingTime));
+
+    for (int channel = 0; channel < static_cast<int>(channels.size()); ++channel)
+    {
+        auto& state = channels[static_cast<size_t>(channel)];
+        if (!state.pending)
+            continue;
+
+        // Held notes carry on; only the differences are written
+        releaseNotes(tick, channel, false);
+
+        if (settings.includePitchBend && state.numPendingNotes == 1)
+            writePitchBend(tick, channel, state.pendingSolo);
+
+        for (int note = 0; note < 128; ++note)
+        {
+            if (state.pendingVelocities[note] > 0 && !state.soundingNotes[note])
+            {
+                writeChannelMessage(tick, channel, 0x90, note, state.pendingVelocities[note]);
+                state.soundingNotes[note] = true;
+            }
+        }
+
+        state.pendingVelocities.fill(0);
+        state.numPendingNotes = 0;
+        state.pending = false;
+    }
+
+    pendingTime = -1.0;
+}
+
+void MidiFileExporter::addEvent(const PitchEvent& event)
+{
+    if (finished)
+        return;
+
+    if (event.timeInSeconds != pendingTime)
+        flushChord();
+
+    pendingTime = event.timeInSeconds;
+    lastEventTime = event.timeInSeconds;
+
+    auto& state = channels[static_cast<size_t>((settings.channel - 1 + juce::jmax(0, event.channel)) % 16)];
+    state.pending = true;
+
+    // A rest contributes nothing, so the chord it belongs to is silence
+    if (event.isRest() || event.midiNote > 127 || event.frequency <= 0.0f)
+        return;
+
+    if (state.pendingVelocities[event.midiNote] == 0)
+        ++state.numPendingNotes;
+
+    state.pendingVelocities[event.midiNote] = static_cast<juce::uint8>(juce::jlimit(1, 127, juce::roundToInt(event.velocity)));
+    state.pendingSolo = event;
+}
+
+bool MidiFileExporter::finish(double endTimeInSeconds)
+{
+    if (finished)
+        return false;
+
+    flushChord();
+    finished = true;
+
+    const double endTime = endTimeInSeconds >= 0.0 ? endTimeInSeconds : lastEventTime + settings.finalNoteLength;
+    const juce::int64 endTick = juce::jmax(lastTick, secondsToTicks(endTime));
+
+    for (int channel = 0; channel < static_cast<int>(channels.size()); ++channel)
+    {
+        releaseNotes(endTick, channel, true);
+
+        const int lastPitchBend = channels[static_cast<size_t>(channel)].lastPitchBend;
+        if (lastPitchBend >= 0 && lastPitchBend != pitchBendCentre)
+            writeChannelMessage(endTick, channel, 0xe0, pitchBendCentre & 0x7f, pitchBendCentre >> 7);
+    }
+
+    writeMetaEvent(endTick, 0x2f, nullptr, 0);
+
+    // Go back and fill in the track chunk length now that it is known
+    const juce::int64 trackEndPosition = stream.getPosition();
+
+    if (!stream.setPosition(trackLengthPosition))
+        return false;
+
+    const bool ok = stream.writeIntBigEndian(static_cast<int>(trackEndPosition - trackStartPosition));
+    stream.setPosition(trackEndPosition);
+    stream.flush();
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PitchEvent.h"
+
+// Streaming Standard MIDI File writer for the pitch log
+//
+// Turns a time-ordered run of PitchEvents into note-on/note-off pairs on a single-track
+// (format 0) file. Events sharing a timestamp form one chord (the polyphonic log writes one
+// event per voice); notes missing from the next chord are released. Optional pitch-bend carries
+// the cents offset while a single note sounds. Each input channel of the log is a separate voice
+// on a MIDI channel of its own, so their chords and bends never interfere.
+// Events are written to the stream as they are added, so the log never has to be copied into
+// a juce::MidiMessageSequence first; finish() patches the track length, which needs a seekable
+// stream such as a juce::FileOutputStream. The result reads back with juce::MidiFile.
+class MidiFileExporter
+{
+public:
+    struct Settings
+    {
+        int ticksPerQuarterNote = 960;
+        double bpm = 120.0;
+        int channel = 1;  // for input channel 0; input channel n goes out n channels higher, wrapping after 16
+
+        bool includePitchBend = false;
+        float pitchBendRangeSemitones = 2.0f; // must match the receiving synth's bend range
+
+        // Used to end the last note when finish() is not given an end time
+        double finalNoteLength = 0.1;
+    };
+
+    MidiFileExporter(juce::OutputStream& destination, const Settings& settings);
+
+    // Events must arrive in time order
+    void addEvent(const PitchEvent& event);
+
+    // Closes any sounding note at endTimeInSeconds (or shortly after the last event if negative)
+    // and completes the file. Returns false if the stream could not be written or rewound.
+    bool finish(double endTimeInSeconds = -1.0);
+
+    juce::int64 secondsToTicks(double seconds) const;
+
+private:
+    void writeHeader();
+    void writeDelta(juce::int64 tick);
+    void writeVariableLength(juce::uint32 value);
+    void writeChannelMessage(juce::int64 tick, int channel, int status, int data1, int data2);
+    void writeMetaEvent(juce::int64 tick, int type, const void* data, int size);
+    void writePitchBend(juce::int64 tick, int channel, const PitchEvent& event);
+    void flushChord();
+    void releaseNotes(juce::int64 tick, int channel, bool all);
+
+    juce::OutputStream& stream;
+    Settings settings;
+
+    juce::int64 trackLengthPosition = 0;
+    juce::int64 trackStartPosition = 0;
+    juce::int64 lastTick = 0;
+    double lastEventTime = 0.0;
+
+    // Per MIDI channel: notes sounding now, and the chord being gathered for pendingTime (velocity
+    // 0 = absent). Only channels with an event at pendingTime (pending) change when it is flushed.
+    struct ChannelState
+    {
+        std::array<bool, 128> soundingNotes{};
+        std::array<juce::uint8, 128> pendingVelocities{};
+        bool pending = false;
+        int numPendingNotes = 0;
+        PitchEvent pendingSolo{};
+        int lastPitchBend = -1;
+    };
+
+    std::array<ChannelState, 16> channels;
+    double pendingTime = -1.0;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE(MidiFileExporter)
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "MultiResolutionDetector.h"
+#include "SimdKernels.h"
+#include <cmath>
+
+namespace
+{
+    // Band layout: target sample rate and the fundamental range each band is responsible for.
+    // Neighbouring ranges overlap slightly so a note on a boundary is seen by both bands.
+    struct BandSpec
+    {
+        double targetRate;
+        float minFrequency;
+        float maxFrequency;
+        double windowSeconds;
+    };
+
+    const BandSpec bandSpecs[MultiResolutionDetector::numBands] =
+    {
+        { 0.0,     250.0f, 4200.0f, 0.02  }, // full rate, up to ~C8
+        { 12000.0,  60.0f,  300.0f, 0.045 },
+        { 3000.0,   16.0f,   75.0f, 0.13  }  // down to ~C0
+    };
+}
+
+void MultiResolutionDetector::Decimator::prepare(int newFactor, int tapsPerPhase)
+{
+    factor = juce::jmax(1, newFactor);
+    const int numTaps = factor * tapsPerPhase;
+
+    // Windowed-sinc lowpass a little below the new Nyquist
+    taps.resize(numTaps);
+    const double cutoff = 0.45 / factor;
+    const double centre = (numTaps - 1) * 0.5;
+    double total = 0.0;
+
+    for (int i = 0; i < numTaps; ++i)
+    {
+        const double x = i - centre;
+        const double sinc = x == 0.0 ? 2.0 * cutoff
+                                     : std::sin(2.0 * juce::MathConstants<double>::pi * cutoff * x) / (juce::MathConstants<double>::pi * x);
+        const double window = 0.42 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * i / (numTaps - 1))
+                                   + 0.08 * std::cos(4.0 * juce::MathConstants<double>::pi * i / (numTaps - 1));
+        taps[i] = static_cast<float>(sinc * window);
+        total += taps[i];
+    }
+
+    for (auto& t : taps)
+        t = static_cast<float>(t / total);
+
+    history.assign(static_cast<size_t>(numTaps) * 2, 0.0f);
+    reset();
+}
+
+void MultiResolutionDetector::Decimator::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    counter = 0;
+    writeIndex = 0;
+}
+
+bool MultiResolutionDetector::Decimator::process(float input, float& output)
+{
+    const int numTaps = static_cast<int>(taps.size());
+
+    history[writeIndex] = input;
+    history[writeIndex + numTaps] = input;
+    writeIndex = (writeIndex + 1) % numTaps;
+
+    if (++counter < factor)
+        return false;
+
+    counter = 0;
+
+    // history[writeIndex .. writeIndex + numTaps) is oldest to newest
+    const float* x = history.data() + writeIndex;
+    float sum = 0.0f;
+    for (int i = 0; i < numTaps; ++i)
+        sum += x[i] * taps[i];
+
+    output = sum;
+    return true;
+}
+
+void MultiResolutionDetector::Band::push(float sample)
+{
+    const int size = static_cast<int>(ring.size()) / 2;
+    ring[ringWrite] = sample;
+    ring[ringWrite + size] = sample;
+    ringWrite = (ringWrite + 1) % size;
+    ringFilled = juce::jmin(ringFilled + 1, size);
+}
+
+void MultiResolutionDetector::prepare(double sampleRate)
+{
+    double rate = sampleRate;
+
+    for (int b = 0; b < numBands; ++b)
+    {
+        const auto& spec = bandSpecs[b];
+
+        if (b > 0)
+        {
+            const int factor = juce::jmax(1, juce::roundToInt(rate / spec.targetRate));
+            decimators[b - 1].prepare(factor, 16);
+            rate /= factor;
+        }
+
+        auto& band = bands[b];
+        band.rate = rate;
+        band.minFrequency = spec.minFrequency;
+        band.maxFrequency = spec.maxFrequency;
+        band.windowLength = juce::jmax(64, static_cast<int>(rate * spec.windowSeconds));
+        band.minTau = juce::jmax(2, static_cast<int>(rate / spec.maxFrequency));
+        band.maxTau = juce::jmax(band.minTau + 2, static_cast<int>(rate / spec.minFrequency));
+
+        const int frameLength = band.windowLength + band.maxTau + 2;
+        band.ring.assign(static_cast<size_t>(frameLength) * 2, 0.0f);
+        band.frame.assign(frameLength, 0.0f);
+        band.diff.assign(band.maxTau + 2, 0.0f);
+    }
+
+    reset();
+}
+
+void MultiResolutionDetector::reset()
+{
+    for (auto& band : bands)
+    {
+        std::fill(band.ring.begin(), band.ring.end(), 0.0f);
+        band.ringWrite = 0;
+        band.ringFilled = 0;
+    }
+
+    for (auto& decimator : decimators)
+        decimator.reset();
+
+    lastEndPosition = -1;
+}
+
+void MultiResolutionDetector::feed(float sample)
+{
+    bands[0].push(sample);
+
+    float value = sample;
+    for (int b = 1; b < numBands; ++b)
+    {
+        if (!decimators[b - 1].process(value, value))
+            return;
+
+        bands[b].push(value);
+    }
+}
+
+void MultiResolutionDetector::pushSamples(const float* samples, int numSamples, juce::int64 endPosition)
+{
+    juce::int64 numNew = endPosition - lastEndPosition;
+
+    // First call or skipped hops: take whatever history is available
+    if (lastEndPosition < 0 || numNew <= 0 || numNew > numSamples)
+        numNew = numSamples;
+
+    for (int i = numSamples - static_cast<int>(numNew); i < numSamples; ++i)
+        feed(samples[i]);
+
+    lastEndPosition = endPosition;
+}
+
+MultiResolutionDetector::Result MultiResolutionDetector::analyseBand(Band& band, float threshold)
+{
+    Result result;
+    const int frameLength = static_cast<int>(band.frame.size());
+
+    if (band.ringFilled < frameLength)
+        return result;
+
+    // Newest frameLength samples, oldest first
+    const int size = static_cast<int>(band.ring.size()) / 2;
+    const float* src = band.ring.data() + (band.ringWrite + size - frameLength) % size;
+    std::copy(src, src + frameLength, band.frame.data());
+
+    const float* x = band.frame.data();
+    const int window = band.windowLength;
+
+    if (std::sqrt(SimdKernels::sumOfSquares(x, window) / window) < 0.01f)
+        return result;
+
+    // Fixed integration window difference function, only over this band's lags
+    float* diff = band.diff.data();
+    const int numLags = band.maxTau + 2;
+
+    diff[0] = 0.0f;
+    for (int tau = 1; tau < numLags; ++tau)
+        diff[tau] = SimdKernels::sumOfSquaredDifferences(x, x + tau, window);
+
+    // Cumulative mean normalized difference
+    SimdKernels::cumulativeMeanNormalise(diff, numLags);
+
+    int bestTau = 0;
+    for (int tau = band.minTau; tau <= band.maxTau; ++tau)
+    {
+        if (diff[tau] < threshold && diff[tau] < diff[tau - 1] && diff[tau] <= diff[tau + 1])
+        {
+            bestTau = tau;
+            break;
+        }
+    }
+
+    if (bestTau == 0)
+    {
+        float minVal = 1.0f;
+        for (int tau = band.minTau; tau <= band.maxTau; ++tau)
+        {
+            if (diff[tau] < minVal)
+            {
+                minVal = diff[tau];
+                bestTau = tau;
+            }
+        }
+    }
+
+    if (bestTau < 2)
+        return result;
+
+    // Parabolic interpolation
+    const float s0 = diff[bestTau - 1];
+    const float s1 = diff[bestTau];
+    const float s2 = diff[bestTau + 1];
+
+    float refinedTau = static_cast<float>(bestTau);
+    const float denom = s0 - 2.0f * s1 + s2;
+    if (std::abs(denom) > 0.0001f)
+        refinedTau += juce::jlimit(-1.0f, 1.0f, 0.5f * (s0 - s2) / denom);
+
+    result.frequency = static_cast<float>(band.rate / refinedTau);
+    result.confidence = s1;
+    return result;
+}
+
+MultiResolutionDetector::Result MultiResolutionDetector::detect(float threshold)
+{
+    Result best;
+
+    // Highest band first: a confident dip there means lower bands would only see sub-multiples of it
+    for (int b = 0; b < numBands; ++b)
+    {
+        Result candidate = analyseBand(bands[b], threshold);
+        candidate.band = b;
+
+        if (candidate.frequency <= 0.0f)
+            continue;
+
+        if (candidate.confidence < threshold)
+            return candidate;
+
+        if (best.frequency <= 0.0f || candidate.confidence < best.confidence)
+            best = candidate;
+    }
+
+    return best;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Band-split YIN detector
+//
+// The input is analysed at several sample rates at once. The high band runs at the host rate on a
+// short window; each lower band is produced by a cascaded FIR decimator (only every Dth output is
+// computed) and keeps its own history, so low registers get long effective windows while the lag
+// search per band stays short. Each band searches only its own tau range and the final stage picks
+// the highest band with a confident dip, mirroring YIN's "first dip" rule across bands.
+class MultiResolutionDetector
+{
+public:
+    struct Result
+    {
+        float frequency = 0.0f;
+        float confidence = 1.0f; // CMND value at the chosen lag, lower is better
+        int band = -1;
+    };
+
+    void prepare(double sampleRate);
+    void reset();
+
+    // samples holds the most recent numSamples input samples ending at absolute position endPosition;
+    // only the part not seen by the previous call is fed to the band histories
+    void pushSamples(const float* samples, int numSamples, juce::int64 endPosition);
+
+    Result detect(float threshold = 0.15f);
+
+    static constexpr int numBands = 3;
+
+private:
+    // Lowpass + downsample by an integer factor, computing only the retained outputs
+    struct Decimator
+    {
+        void prepare(int factor, int tapsPerPhase);
+        void reset();
+        bool process(float input, float& output);
+
+        int factor = 1;
+        int counter = 0;
+        int writeIndex = 0;
+        std::vector<float> taps;
+        std::vector<float> history; // doubled so the dot product never wraps
+    };
+
+    struct Band
+    {
+        double rate = 0.0;
+        float minFrequency = 0.0f;
+        float maxFrequency = 0.0f;
+        int windowLength = 0;
+        int minTau = 0;
+        int maxTau = 0;
+
+        std::vector<float> ring;
+        int ringWrite = 0;
+        int ringFilled = 0;
+
+        std::vector<float> frame;
+        std::vector<float> diff;
+
+        void push(float sample);
+    };
+
+    void feed(float sample);
+    Result analyseBand(Band& band, float threshold);
+
+    Band bands[numBands];
+    Decimator decimators[numBands - 1]; // decimators[i] feeds bands[i + 1] from bands[i]
+    juce::int64 lastEndPosition = -1;
+};
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "PerceptualDetector.h"
+#include <cmath>
+
+namespace
+{
+    // Same search range as the engine's YIN
+    constexpr float minFrequency = 70.0f;
+    constexpr float maxFrequency = 1200.0f;
+
+    // IEC 61672 A-weighting as a linear gain, 1 at 1 kHz
+    float aWeighting(float frequency)
+    {
+        auto response = [](double f)
+            {
+                const double f2 = f * f;
+                return 12194.0 * 12194.0 * f2 * f2
+                     / ((f2 + 20.6 * 20.6) * std::sqrt((f2 + 107.7 * 107.7) * (f2 + 737.9 * 737.9)) * (f2 + 12194.0 * 12194.0));
+            };
+
+        return static_cast<float>(response(frequency) / response(1000.0));
+    }
+
+    // Sum of exp(i theta m) for m in [0, length)
+    std::complex<double> dirichlet(double theta, int length)
+    {
+        const double half = std::sin(0.5 * theta);
+        if (std::abs(half) < 1.0e-12)
+            return static_cast<double>(length);
+
+        const double phase = 0.5 * theta * (length - 1);
+        return std::sin(0.5 * length * theta) / half * std::complex<double>(std::cos(phase), std::sin(phase));
+    }
+}
+
+void PerceptualDetector::prepare(double newSampleRate, int minFrameLength, int maxFrameLength)
+{
+    sampleRate = newSampleRate;
+    const float maxPartialFrequency = static_cast<float>(juce::jmin(5000.0, sampleRate * 0.45));
+
+    // CQ bins start an octave (and a guard bin) below the lowest candidate so there is somewhere to
+    // look for its subharmonic
+    const float lowestBin = minFrequency * std::pow(2.0f, -static_cast<float>(firstCandidateBin) / binsPerOctave);
+    const int numBins = static_cast<int>(std::log2(maxPartialFrequency / lowestBin) * binsPerOctave) + 1;
+    binFrequencies.resize(static_cast<size_t>(numBins));
+    loudnessWeights.resize(static_cast<size_t>(numBins));
+    for (int j = 0; j < numBins; ++j)
+    {
+        binFrequencies[j] = lowestBin * std::pow(2.0f, static_cast<float>(j) / binsPerOctave);
+        loudnessWeights[j] = aWeighting(binFrequencies[j]);
+    }
+
+    for (int h = 1; h <= numHarmonics; ++h)
+    {
+        harmonicOffsets[h - 1] = juce::roundToInt(binsPerOctave * std::log2(static_cast<double>(h)));
+        betweenOffsets[h - 1] = juce::roundToInt(binsPerOctave * std::log2(h - 0.5));
+    }
+
+    // Klapuri's weights, as in PolyphonicDetector: low partials of low F0s count most
+    numCandidates = static_cast<int>(std::log2(maxFrequency / minFrequency) * binsPerOctave) + 1;
+    templateWeights.resize(static_cast<size_t>(numCandidates * numHarmonics));
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        const float f0 = binFrequencies[static_cast<size_t>(firstCandidateBin + c)];
+        for (int h = 1; h <= numHarmonics; ++h)
+            templateWeights[static_cast<size_t>(c * numHarmonics + h - 1)] = (f0 + 27.0f) / (h * f0 + 320.0f);
+    }
+
+    minOrder = juce::findHighestSetBit(static_cast<juce::uint32>(minFrameLength));
+    const int maxOrder = juce::findHighestSetBit(static_cast<juce::uint32>(maxFrameLength));
+
+    resolutions.clear();
+    resolutions.resize(static_cast<size_t>(maxOrder - minOrder + 1));
+    for (int o = minOrder; o <= maxOrder; ++o)
+        buildKernel(resolutions[static_cast<size_t>(o - minOrder)], o);
+
+    workspace.assign(static_cast<size_t>(2 << maxOrder), 0.0f);
+    loudness.assign(static_cast<size_t>(numBins), 0.0f);
+    salience.assign(static_cast<size_t>(numCandidates), 0.0f);
+
+    setFrameLength(maxFrameLength);
+}
+
+void PerceptualDetector::buildKernel(Resolution& r, int fftOrder) const
+{
+    const int size = 1 << fftOrder;
+    const double q = 1.0 / (std::pow(2.0, 1.0 / binsPerOctave) - 1.0);
+
+    r.fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+    r.binWidth = static_cast<float>(sampleRate / size);
+    r.bands.resize(binFrequencies.size());
+    r.kernel.clear();
+
+    std::vector<std::complex<double>> values;
+
+    for (size_t j = 0; j < binFrequencies.size(); ++j)
+    {
+        // A periodic Hann window of Q periods, centred in the FFT window and normalised to unit gain,
+        // times exp(i omega n); its DFT is three shifted Dirichlet kernels, so no FFT is needed here
+        const double frequency = binFrequencies[j];
+        const int length = juce::jlimit(16, size, static_cast<int>(std::round(q * sampleRate / frequency)));
+        const int start = (size - length) / 2;
+        const double omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double shift = juce::MathConstants<double>::twoPi / length;
+
+        // Hann sidelobes are far below kernelThreshold eight of its own bins out
+        const int centre = juce::roundToInt(frequency / r.binWidth);
+        const int radius = static_cast<int>(std::ceil(8.0 * size / length)) + 2;
+        const int lo = juce::jmax(0, centre - radius);
+        const int hi = juce::jmin(size / 2, centre + radius);
+
+        values.resize(static_cast<size_t>(hi - lo + 1));
+        double peak = 0.0;
+        for (int k = lo; k <= hi; ++k)
+        {
+            const double phi = omega - juce::MathConstants<double>::twoPi * k / size;
+            const auto sum = 0.5 * dirichlet(phi, length) - 0.25 * (dirichlet(phi + shift, length) + dirichlet(phi - shift, length));
+            const auto value = std::polar(2.0 / length, -juce::MathConstants<double>::twoPi * k * start / size) * sum;
+
+            values[static_cast<size_t>(k - lo)] = value;
+            peak = juce::jmax(peak, std::abs(value));
+        }
+
+        int first = lo, last = hi;
+        while (first < last && std::abs(values[static_cast<size_t>(first - lo)]) < kernelThreshold * peak)
+            ++first;
+        while (last > first && std::abs(values[static_cast<size_t>(last - lo)]) < kernelThreshold * peak)
+            --last;
+
+        auto& band = r.bands[j];
+        band.firstBin = first;
+        band.numBins = last - first + 1;
+        band.offset = r.kernel.size();
+
+        for (int k = first; k <= last; ++k)
+            r.kernel.push_back(std::complex<float>(std::conj(values[static_cast<size_t>(k - lo)]) / static_cast<double>(size)));
+    }
+}
+
+void PerceptualDetector::setFrameLength(int frameLength)
+{
+    order = juce::jlimit(minOrder, minOrder + static_cast<int>(resolutions.size()) - 1,
+                         juce::findHighestSetBit(static_cast<juce::uint32>(frameLength)));
+}
+
+PerceptualDetector::TemplateSums PerceptualDetector::templateSumsOf(int candidate) const
+{
+    const int numBins = static_cast<int>(loudness.size());
+    const int base = firstCandidateBin + candidate;
+    const float* weights = templateWeights.data() + candidate * numHarmonics;
+    TemplateSums sums;
+
+    for (int h = 0; h < numHarmonics; ++h)
+    {
+        // A bin either side absorbs the rounding of the harmonic and candidate positions
+        const int bin = base + harmonicOffsets[h];
+        if (bin + 1 >= numBins)
+            break;
+
+        sums.onHarmonics += weights[h] * juce::jmax(loudness[bin - 1], loudness[bin], loudness[bin + 1]);
+        const int between = base + betweenOffsets[h];
+        sums.betweenHarmonics += weights[h] * juce::jmax(loudness[between - 1], loudness[between], loudness[between + 1]);
+    }
+
+    return sums;
+}
+
+float PerceptualDetector::refineFrequency(const Resolution& r, float f0) const
+{
+    // Hann-windowed magnitude of bin k, from the unwindowed spectrum by the window's three-tap convolution
+    const auto* spectrum = reinterpret_cast<const std::complex<float>*>(workspace.data());
+    auto magnitude = [spectrum](int k) { return std::abs(0.5f * spectrum[k] - 0.25f * (spectrum[k - 1] + spectrum[k + 1])); };
+
+    const int lastBin = r.fft->getSize() / 2 - 1;
+    double weightedSum = 0.0;
+    double totalWeight = 0.0;
+
+    for (int h = 1; h <= 5 && h * f0 < binFrequencies.back(); ++h)
+    {
+        const float centre = h * f0 / r.binWidth;
+        const float radius = juce::jmax(1.0f, 0.25f * f0 / r.binWidth);
+        const int lo = juce::jmax(2, static_cast<int>(std::floor(centre - radius)));
+        const int hi = juce::jmin(lastBin - 1, static_cast<int>(std::ceil(centre + radius)));
+        if (hi <= lo)
+            continue;
+
+        int bin = lo;
+        float peak = magnitude(lo);
+        for (int k = lo + 1; k <= hi; ++k)
+        {
+            const float m = magnitude(k);
+            if (m > peak)
+            {
+                peak = m;
+                bin = k;
+            }
+        }
+
+        const float below = magnitude(bin - 1);
+        const float above = magnitude(bin + 1);
+        if (peak < below || peak < above)
+            continue;
+
+        const float s0 = std::log(below + 1.0e-9f);
+        const float s1 = std::log(peak + 1.0e-9f);
+        const float s2 = std::log(above + 1.0e-9f);
+        const float denom = s0 - 2.0f * s1 + s2;
+        const float offset = std::abs(denom) > 1.0e-6f ? juce::jlimit(-0.5f, 0.5f, 0.5f * (s0 - s2) / denom) : 0.0f;
+
+        // Partials count for how loud they sound
+        const double weight = static_cast<double>(peak) * aWeighting(h * f0);
+        weightedSum += weight * (bin + offset) * r.binWidth / h;
+        totalWeight += weight;
+    }
+
+    if (totalWeight <= 0.0)
+        return f0;
+
+    // A refinement more than a semitone (or, for bass lobes smeared across the grid, a bin) away has
+    // locked onto something else
+    const auto refined = static_cast<float>(weightedSum / totalWeight);
+    const float tolerance = juce::jmax(f0 * 0.0595f, r.binWidth);
+    return std::abs(refined - f0) < tolerance ? refined : f0;
+}
+
+PitchDetector::Estimate PerceptualDetector::detect(const float* samples, int numSamples)
+{
+    Estimate estimate;
+    const auto& r = resolutions[static_cast<size_t>(order - minOrder)];
+    const int size = 1 << order;
+    jassert(size <= numSamples);
+
+    // Unwindowed: the kernels carry their own windows
+    float* work = workspace.data();
+    std::copy(samples + numSamples - size, samples + numSamples, work);
+    std::fill(work + size, work + size * 2, 0.0f);
+    r.fft->performRealOnlyForwardTransform(work, true);
+
+    const auto* spectrum = reinterpret_cast<const std::complex<float>*>(work);
+    float totalLoudness = 0.0f;
+
+    for (size_t j = 0; j < r.bands.size(); ++j)
+    {
+        const auto& band = r.bands[j];
+        const auto* x = spectrum + band.firstBin;
+        const auto* k = r.kernel.data() + band.offset;
+
+        std::complex<float> sum;
+        for (int b = 0; b < band.numBins; ++b)
+            sum += x[b] * k[b];
+
+        loudness[j] = std::pow(loudnessWeights[j] * std::abs(sum), loudnessExponent);
+        totalLoudness += loudness[j];
+    }
+
+    if (totalLoudness <= 0.0f)
+        return estimate;
+
+    int best = 0;
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        const auto sums = templateSumsOf(c);
+        salience[c] = sums.onHarmonics - betweenHarmonicsWeight * sums.betweenHarmonics;
+        if (salience[c] > salience[static_cast<size_t>(best)])
+            best = c;
+    }
+
+    if (salience[static_cast<size_t>(best)] <= 0.0f)
+        return estimate;
+
+    // How much louder the winning series is than the gaps between its partials; about 0 for noise
+    const auto sums = templateSumsOf(best);
+    estimate.confidence = juce::jlimit(0.0f, 1.0f, 1.0f - sums.betweenHarmonics / sums.onHarmonics);
+
+    if (estimate.confidence < voicedConfidence)
+        return estimate;
+
+    // Parabolic interpolation over the log-frequency grid, then refine from the partials
+    float position = static_cast<float>(best);
+    if (best > 0 && best < numCandidates - 1)
+    {
+        const float s0 = salience[static_cast<size_t>(best - 1)];
+        const float s1 = salience[static_cast<size_t>(best)];
+        const float s2 = salience[static_cast<size_t>(best + 1)];
+        const float denom = s0 - 2.0f * s1 + s2;
+
+        if (std::abs(denom) > 1.0e-9f)
+            position += juce::jlimit(-0.5f, 0.5f, 0.5f * (s0 - s2) / denom);
+    }
+
+    estimate.frequency = refineFrequency(r, minFrequency * std::pow(2.0f, position / binsPerOctave));
+    return estimate;
+}
\ No newline at end of file
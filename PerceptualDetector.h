@@ -0,0 +1,90 @@
+#pragma once
+
+#include "PitchDetector.h"
+#include <array>
+#include <complex>
+
+// Perceptual pitch estimator: harmonic-template salience on a loudness-weighted constant-Q spectrum
+//
+// The newest power-of-two part of the frame goes through one FFT, and a constant-Q spectrum with
+// binsPerOctave bins is read off it through a sparse spectral kernel (Brown & Puckette): each CQ bin
+// is the inner product of the spectrum with the transform of a Hann-windowed complex exponential,
+// which is only non-negligible in a narrow band of FFT bins. Kernels longer than the window are
+// clipped to it, so the lowest bins lose some Q on short frames.
+//
+// Each CQ magnitude is A-weighted (the 40 phon equal-loudness contour, inverted) and compressed to
+// roughly specific loudness, so a partial counts for what it adds to how loud the note sounds rather
+// than for its physical power. A candidate F0's salience is the loudness at its harmonics minus the
+// loudness half way between them, both weighted per harmonic as in PolyphonicDetector. A missing or
+// weak fundamental still gets the pitch listeners hear, and a candidate an octave too high loses the
+// partials that fall between its harmonics. Confidence is one minus the ratio of the two sums, about
+// 0.3 for noise and above 0.8 for a clean note.
+//
+// Kernels are built in prepare() for every window size, and template weights for every candidate.
+// A kernel keeps under 1% of a dense CQ matrix, so detect() costs one FFT plus at most ~14000 complex
+// multiply-adds.
+class PerceptualDetector : public PitchDetector
+{
+public:
+    const char* getName() const override { return "perceptual"; }
+
+    void prepare(double sampleRate, int minFrameLength, int maxFrameLength) override;
+    void setFrameLength(int frameLength) override;
+    Estimate detect(const float* samples, int numSamples) override;
+
+private:
+    static constexpr int binsPerOctave = 36;
+    static constexpr int numHarmonics = 10;
+    static constexpr float kernelThreshold = 0.0054f;   // of a kernel's peak; smaller entries are dropped
+    static constexpr float loudnessExponent = 0.6f;     // on amplitude, i.e. intensity^0.3 (Stevens)
+    static constexpr float betweenHarmonicsWeight = 1.0f;  // less lets an octave-up candidate win on a missing fundamental
+    static constexpr float voicedConfidence = 0.55f;     // below this the frame is reported unvoiced
+
+    // CQ bin of the lowest candidate: an octave for its subharmonic, plus one guard bin so the
+    // neighbours of the h - 1/2 = 1/2 position stay inside the spectrum
+    static constexpr int firstCandidateBin = binsPerOctave + 1;
+
+    // One CQ bin's non-zero stretch of the spectral kernel, conjugated and scaled by 1 / fftSize
+    struct KernelBand
+    {
+        int firstBin = 0;
+        int numBins = 0;
+        size_t offset = 0;  // into Resolution::kernel
+    };
+
+    // One window size
+    struct Resolution
+    {
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<KernelBand> bands;
+        std::vector<std::complex<float>> kernel;
+        float binWidth = 1.0f;
+    };
+
+    // Template-weighted loudness at a candidate's harmonics, and half way between them
+    struct TemplateSums
+    {
+        float onHarmonics = 0.0f;
+        float betweenHarmonics = 0.0f;
+    };
+
+    void buildKernel(Resolution& resolution, int order) const;
+    TemplateSums templateSumsOf(int candidate) const;
+    float refineFrequency(const Resolution& resolution, float f0) const;
+
+    double sampleRate = 48000.0;
+    int minOrder = 0;
+    int order = 0;  // of the current frame length
+
+    std::vector<Resolution> resolutions;  // minOrder upwards
+    std::vector<float> binFrequencies;    // centre of each CQ bin, firstCandidateBin below the lowest candidate upwards
+    std::vector<float> loudnessWeights;   // A-weighting gain of each CQ bin
+    std::vector<float> templateWeights;   // numHarmonics per candidate
+    std::array<int, numHarmonics> harmonicOffsets{};  // CQ bins from F0 to harmonic h
+    std::array<int, numHarmonics> betweenOffsets{};   // and to h - 1/2
+    int numCandidates = 0;
+
+    std::vector<float> workspace;
+    std::vector<float> loudness;  // per CQ bin
+    std::vector<float> salience;  // per candidate
+};
\ No newline at end of file
@@ -0,0 +1,818 @@
+#include "PitchDetectionEngine.h"
+#include "YinCore.h"
+#include <cmath>
+
+namespace
+{
+    // Float, double or pairwise accumulation, fixed at compile time (see YinCore.h)
+    using Core = YinCore<Accumulation::Default>;
+
+    // Adaptive scheduling
+    constexpr int onsetSegmentLength = 256;        // samples per level comparison
+    constexpr double onsetPowerRatio = 4.0;        // +6 dB over the rest of the window
+    constexpr float confidentAperiodicity = 0.1f;  // normalised difference at the tracked lag
+    constexpr float levelTolerance = 1.19f;        // +/-1.5 dB counts as unchanged
+    constexpr int maxVerifiedFrames = 8;           // then a full pass, whatever happens
+    constexpr float octaveGuard = 0.5f;            // any dip below this around half the lag forces a full pass
+
+    // Direct difference functions smaller than this (samples x lags) are not worth splitting across threads
+    constexpr juce::int64 minParallelProducts = 1 << 22;
+
+    // The polyphonic detector gates on its newest FFT block, which is more than half the window,
+    // so that block's RMS can exceed the window's by up to sqrt(2)
+    constexpr float polyphonicGateHeadroom = 1.4142136f;
+
+    // Zero-padded so the circular correlation doesn't wrap for any tau < numSamples / 2
+    int differenceFFTOrder(int numSamples)
+    {
+        return juce::findHighestSetBit(static_cast<juce::uint32>(juce::nextPowerOfTwo(numSamples + numSamples / 2)));
+    }
+
+    // Hann windows for every supported window size, built on first use and shared by all engines (about 2 MB)
+    const float* getHannWindow(int size)
+    {
+        using Engine = PitchDetectionEngine;
+
+        static const std::vector<std::vector<float>> windows = []
+        {
+            std::vector<std::vector<float>> tables;
+            for (int n = Engine::minBufferSize; n <= Engine::maxBufferSize; n += Engine::bufferSizeStep)
+            {
+                auto& window = tables.emplace_back(static_cast<size_t>(n));
+                for (int i = 0; i < n; ++i)
+                    window[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (n - 1)));
+            }
+            return tables;
+        }();
+
+        jassert(size == Engine::snapBufferSize(size));
+        return windows[static_cast<size_t>((size - Engine::minBufferSize) / Engine::bufferSizeStep)].data();
+    }
+}
+
+PitchDetectionEngine::PitchDetectionEngine()
+{
+    prepare(48000.0, 4096, 6000);
+}
+
+int PitchDetectionEngine::snapBufferSize(int size)
+{
+    return juce::jlimit(minBufferSize, maxBufferSize, juce::roundToInt(size / static_cast<double>(bufferSizeStep)) * bufferSizeStep);
+}
+
+void PitchDetectionEngine::prepare(double newSampleRate, int newBufferSize, int newHopSize, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    bufferSize.store(snapBufferSize(newBufferSize), std::memory_order_relaxed);
+    hopSize.store(juce::jmax(1, newHopSize), std::memory_order_relaxed);
+    pendingBufferSize = getBufferSize();
+    pendingHopSize = getHopSize();
+    newNumChannels = juce::jlimit(1, maxChannels, newNumChannels);
+
+    // Build the shared windows here rather than on the first analysed frame
+    getHannWindow(minBufferSize);
+
+    if (differenceFFTs.empty())
+        for (int order = differenceFFTOrder(minBufferSize); order <= differenceFFTOrder(maxBufferSize); ++order)
+            differenceFFTs.push_back(std::make_unique<juce::dsp::FFT>(order));
+
+    // Everything is sized for the largest window, so later size changes never allocate
+    if (newNumChannels != numChannels)
+    {
+        numChannels = newNumChannels;
+        analysisBuffer.assign(static_cast<size_t>(maxBufferSize) * newNumChannels, 0.0f);
+
+        channelAnalysis.resize(newNumChannels);
+        for (auto& channel : channelAnalysis)
+        {
+            if (channel == nullptr)
+                channel = std::make_unique<ChannelAnalysis>();
+
+            channel->processingBuffer.assign(maxBufferSize, 0.0f);
+            channel->differenceBuffer.assign(maxBufferSize / 2, 0.0f);
+            channel->fftWorkspace.assign(static_cast<size_t>(differenceFFTs.back()->getSize()) * 2, 0.0f);
+            channel->energyPrefix.assign(static_cast<size_t>(maxBufferSize) + 1, 0.0);
+        }
+
+        // Force fresh buffer fill after resize
+        writePosition = 0;
+        samplesCollected = 0;
+    }
+
+    // Only the lags the YIN search can reach are tracked (see maxTau in detectPitchYIN)
+    const int maxSlidingLags = juce::jmin(maxBufferSize / 2, static_cast<int>(sampleRate / 70.0) + 2);
+
+    for (auto& channel : channelAnalysis)
+    {
+        channel->slidingDifference.prepare(maxSlidingLags, maxBufferSize - maxSlidingLags, maxBufferSize);
+        channel->multiResolutionDetector.prepare(sampleRate);
+        channel->polyphonicDetector.prepare(sampleRate, getBufferSize());
+        channel->polyphonicDetector.setMaxVoices(maxVoices);
+        channel->pitchTracker.prepare(70.0f, 1200.0f);  // the YIN search range
+        channel->mcleodDetector.prepare(sampleRate, minBufferSize, maxBufferSize);
+        channel->swipeDetector.prepare(sampleRate, minBufferSize, maxBufferSize);
+        channel->perceptualDetector.prepare(sampleRate, minBufferSize, maxBufferSize);
+        channel->trackedLag = 0.0f;
+        configureChannel(*channel, getBufferSize());
+    }
+
+    dcBlockerX.fill(0.0f);
+    dcBlockerY.fill(0.0f);
+    samplesUntilNextHop = getHopSize();
+    onsetPending = false;
+    segmentEnergy.fill(0.0);
+    segmentLength = 0;
+
+    // Match the running energies to whatever history was kept
+    sumWindowEnergies();
+}
+
+void PitchDetectionEngine::reset()
+{
+    std::fill(analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
+    writePosition = 0;
+    samplesCollected = 0;
+    samplePosition = 0;
+    samplesUntilNextHop = getHopSize();
+    dcBlockerX.fill(0.0f);
+    dcBlockerY.fill(0.0f);
+    windowEnergy.fill(0.0);
+    segmentEnergy.fill(0.0);
+    segmentLength = 0;
+    onsetPending = false;
+
+    for (auto& channel : channelAnalysis)
+    {
+        channel->slidingDifference.reset();
+        channel->multiResolutionDetector.reset();
+        channel->pitchTracker.reset();
+        channel->trackedLag = 0.0f;
+    }
+}
+
+void PitchDetectionEngine::configureChannel(ChannelAnalysis& channel, int numSamples)
+{
+    // Only switches between tables built in prepare(); the sliding state rebuilds itself from the next frame
+    const int numLags = juce::jmin(numSamples / 2, static_cast<int>(sampleRate / 70.0) + 2);
+    channel.slidingDifference.configure(numLags, numSamples - numLags, numSamples);
+    channel.polyphonicDetector.setFrameLength(numSamples);
+    channel.mcleodDetector.setFrameLength(numSamples);
+    channel.swipeDetector.setFrameLength(numSamples);
+    channel.perceptualDetector.setFrameLength(numSamples);
+    channel.frameLength = numSamples;
+}
+
+PitchDetectionEngine::SchedulingStats PitchDetectionEngine::getSchedulingStats() const
+{
+    SchedulingStats stats;
+    stats.fullPasses = fullPasses.load(std::memory_order_relaxed);
+    stats.verifiedFrames = verifiedFrames.load(std::memory_order_relaxed);
+    stats.skippedFrames = skippedFrames.load(std::memory_order_relaxed);
+    stats.onsetHops = onsetHops.load(std::memory_order_relaxed);
+    return stats;
+}
+
+PitchDetectionEngine::DetectorStats PitchDetectionEngine::getDetectorStats(Detector detector) const
+{
+    const auto index = static_cast<size_t>(detector);
+
+    DetectorStats stats;
+    stats.frames = detectorFrames[index].load(std::memory_order_relaxed);
+
+    if (stats.frames > 0)
+        stats.meanMicroseconds = juce::Time::highResolutionTicksToSeconds(detectorTicks[index].load(std::memory_order_relaxed))
+                               * 1.0e6 / stats.frames;
+
+    return stats;
+}
+
+void PitchDetectionEngine::resetSchedulingStats()
+{
+    fullPasses.store(0, std::memory_order_relaxed);
+    verifiedFrames.store(0, std::memory_order_relaxed);
+    skippedFrames.store(0, std::memory_order_relaxed);
+    onsetHops.store(0, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < detectorFrames.size(); ++i)
+    {
+        detectorFrames[i].store(0, std::memory_order_relaxed);
+        detectorTicks[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void PitchDetectionEngine::recordDetectorCost(Detector detector, juce::int64 startTicks)
+{
+    const auto index = static_cast<size_t>(detector);
+    detectorFrames[index].fetch_add(1, std::memory_order_relaxed);
+    detectorTicks[index].fetch_add(juce::Time::getHighResolutionTicks() - startTicks, std::memory_order_relaxed);
+}
+
+void PitchDetectionEngine::setMaxVoices(int newMaxVoices)
+{
+    maxVoices = newMaxVoices;
+
+    for (auto& channel : channelAnalysis)
+        channel->polyphonicDetector.setMaxVoices(newMaxVoices);
+}
+
+void PitchDetectionEngine::prepareSnapshot(Snapshot& snapshot) const
+{
+    snapshot.samples.assign(static_cast<size_t>(maxBufferSize) * numChannels, 0.0f);
+    snapshot.numSamples = 0;
+    snapshot.numChannels = 0;
+}
+
+void PitchDetectionEngine::setAnalysisSize(int newBufferSize, int newHopSize)
+{
+    pendingBufferSize = snapBufferSize(newBufferSize);
+    pendingHopSize = juce::jmax(1, newHopSize);
+}
+
+void PitchDetectionEngine::applyPendingSize()
+{
+    hopSize.store(pendingHopSize, std::memory_order_relaxed);
+
+    if (pendingBufferSize == getBufferSize())
+        return;
+
+    bufferSize.store(pendingBufferSize, std::memory_order_relaxed);
+    sumWindowEnergies();
+}
+
+void PitchDetectionEngine::sumWindowEnergies()
+{
+    const int windowLength = getBufferSize();
+    const int start = (writePosition - windowLength + maxBufferSize) % maxBufferSize;
+    const int firstPart = juce::jmin(windowLength, maxBufferSize - start);
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        const float* plane = analysisBuffer.data() + static_cast<size_t>(c) * maxBufferSize;
+        windowEnergy[c] = SimdKernels::sumOfSquares(plane + start, firstPart) + SimdKernels::sumOfSquares(plane, windowLength - firstPart);
+    }
+}
+
+bool PitchDetectionEngine::collect(const float* const* channelData, int startSample, int numSamples)
+{
+    jassert(numSamples <= samplesUntilNextHop);
+
+    const int windowLength = getBufferSize();
+
+    // Simple DC blocker, written straight into the circular buffers in contiguous runs that stop at the
+    // wrap and at level segment boundaries; every channel is advanced through the same run before moving on
+    int done = 0;
+    while (done < numSamples)
+    {
+        const int chunk = juce::jmin(numSamples - done, maxBufferSize - writePosition, onsetSegmentLength - segmentLength);
+
+        // The samples leaving the window sit windowLength behind the write position (and may wrap)
+        const int leavingStart = (writePosition - windowLength + maxBufferSize) % maxBufferSize;
+        const int leavingFirstPart = juce::jmin(chunk, maxBufferSize - leavingStart);
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            float* plane = analysisBuffer.data() + static_cast<size_t>(c) * maxBufferSize;
+            float* dest = plane + writePosition;
+
+            // Running window energy: drop what leaves the window, add what enters it
+            windowEnergy[c] -= SimdKernels::sumOfSquares(plane + leavingStart, leavingFirstPart)
+                             + SimdKernels::sumOfSquares(plane, chunk - leavingFirstPart);
+            SimdKernels::dcBlock(channelData[c] + startSample + done, dest, chunk, 0.99f, dcBlockerX[c], dcBlockerY[c]);
+
+            const float newEnergy = SimdKernels::sumOfSquares(dest, chunk);
+            windowEnergy[c] += newEnergy;
+            segmentEnergy[c] += newEnergy;
+        }
+
+        writePosition += chunk;
+        done += chunk;
+        samplesUntilNextHop -= chunk;
+        segmentLength += chunk;
+        samplesCollected = juce::jmin(maxBufferSize, samplesCollected + chunk);
+
+        if (writePosition >= maxBufferSize)
+        {
+            writePosition = 0;
+
+            // Re-sum once per lap so rounding in the running totals cannot build up
+            sumWindowEnergies();
+        }
+
+        if (segmentLength == onsetSegmentLength)
+            updateOnsetDetector(numSamples - done);
+    }
+
+    samplePosition += numSamples;
+
+    if (samplesUntilNextHop > 0)
+        return false;
+
+    applyPendingSize();
+    samplesUntilNextHop = getHopSize();
+    onsetPending = false;
+
+    // Once the window has been filled it stays ready (a larger new size may need more history first)
+    return samplesCollected >= getBufferSize();
+}
+
+void PitchDetectionEngine::updateOnsetDetector(int samplesLeftInCall)
+{
+    // A segment well above the rest of the window on any channel is an onset. The next hop is
+    // brought forward to half a window later, so the frame that sees it is half new note
+    // (or to the end of the current collect() call, which the caller has already sized).
+    const int windowLength = getBufferSize();
+    const bool armed = adaptiveScheduling.load(std::memory_order_relaxed) && samplesCollected >= windowLength && !onsetPending
+                       && samplesUntilNextHop > windowLength / 2;
+
+    bool onset = false;
+    for (int c = 0; c < numChannels && armed; ++c)
+    {
+        const double segmentPower = segmentEnergy[c] / segmentLength;
+        const double previousPower = (windowEnergy[c] - segmentEnergy[c]) / juce::jmax(1, windowLength - segmentLength);
+
+        onset = onset || (segmentPower > silenceGate * silenceGate && segmentPower > onsetPowerRatio * previousPower);
+    }
+
+    segmentEnergy.fill(0.0);
+    segmentLength = 0;
+
+    const int onsetHop = juce::jmax(windowLength / 2, samplesLeftInCall);
+
+    if (onset && onsetHop < samplesUntilNextHop)
+    {
+        samplesUntilNextHop = onsetHop;
+        onsetPending = true;
+        onsetHops.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PitchDetectionEngine::takeSnapshot(Snapshot& snapshot) const
+{
+    const int windowLength = getBufferSize();
+    jassert(static_cast<int>(snapshot.samples.size()) >= windowLength * numChannels);
+
+    // Levels come from the running energies; a frame that no detector would look at is not copied
+    bool audible = false;
+    for (int c = 0; c < numChannels; ++c)
+    {
+        snapshot.levels[c] = std::sqrt(static_cast<float>(juce::jmax(0.0, windowEnergy[c]) / windowLength));
+        audible = audible || snapshot.levels[c] * polyphonicGateHeadroom >= silenceGate;
+    }
+
+    snapshot.numSamples = windowLength;
+    snapshot.numChannels = numChannels;
+    snapshot.endSamplePosition = samplePosition;
+    snapshot.timeInSeconds = static_cast<double>(samplePosition) / sampleRate;
+    snapshot.hasSamples = audible || !adaptiveScheduling.load(std::memory_order_relaxed);
+
+    if (!snapshot.hasSamples)
+        return;
+
+    // CRITICAL FIX: Copy circular buffer in sequential order (oldest to newest)
+    // writePosition points to next write location, so the window starts windowLength before it
+    const int start = (writePosition - windowLength + maxBufferSize) % maxBufferSize;
+    const int firstPart = juce::jmin(windowLength, maxBufferSize - start);
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        const float* plane = analysisBuffer.data() + static_cast<size_t>(c) * maxBufferSize;
+        float* dest = snapshot.samples.data() + static_cast<size_t>(c) * windowLength;
+
+        std::copy(plane + start, plane + start + firstPart, dest);
+        std::copy(plane, plane + (windowLength - firstPart), dest + firstPart);
+    }
+}
+
+bool PitchDetectionEngine::isBelowGate(const Snapshot& snapshot, int channel, float headroom) const
+{
+    // The Hann window only ever lowers the level, so a plane below the gate would fail the detector's own gate too
+    return !snapshot.hasSamples
+        || (adaptiveScheduling.load(std::memory_order_relaxed) && snapshot.levels[channel] * headroom < silenceGate);
+}
+
+float PitchDetectionEngine::measureLevel(ChannelAnalysis& channel, const Snapshot& snapshot, const float* samples)
+{
+    // The sliding state has to see every hop, even ones that end up below the RMS gate
+    if (differenceMethod.load(std::memory_order_relaxed) == DifferenceMethod::incremental)
+        channel.slidingDifference.update(samples, snapshot.numSamples, snapshot.endSamplePosition);
+
+    SimdKernels::multiply(channel.processingBuffer.data(), samples, getHannWindow(snapshot.numSamples), snapshot.numSamples);
+    return Core::rms(channel.processingBuffer.data(), snapshot.numSamples);
+}
+
+PitchDetectionEngine::Result PitchDetectionEngine::analyse(const Snapshot& snapshot, int channelIndex)
+{
+    jassert(snapshot.numSamples == snapBufferSize(snapshot.numSamples) && juce::isPositiveAndBelow(channelIndex, snapshot.numChannels));
+
+    auto& channel = *channelAnalysis[static_cast<size_t>(channelIndex)];
+    const float* samples = snapshot.getChannel(channelIndex);
+
+    if (channel.frameLength != snapshot.numSamples)
+        configureChannel(channel, snapshot.numSamples);
+
+    Result result;
+
+    // Skipped hops are fine for the sliding and band-split state, which resync on the next gap
+    if (isBelowGate(snapshot, channelIndex))
+    {
+        skippedFrames.fetch_add(1, std::memory_order_relaxed);
+        channel.trackedLag = 0.0f;
+        result.rms = snapshot.levels[channelIndex];
+
+        // The tracker still has to see the gap to move to its unvoiced states
+        if (pitchTracking.load(std::memory_order_relaxed) && !multiResolution.load(std::memory_order_relaxed))
+            channel.pitchTracker.process({});
+
+        return result;
+    }
+
+    result.rms = measureLevel(channel, snapshot, samples);
+
+    const auto detector = getDetector();
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    if (multiResolution.load(std::memory_order_relaxed))
+    {
+        // Bands keep their own decimated history, so they consume the raw (unwindowed) new samples
+        channel.multiResolutionDetector.pushSamples(samples, snapshot.numSamples, snapshot.endSamplePosition);
+        const auto bandResult = channel.multiResolutionDetector.detect();
+        result.frequency = bandResult.frequency;
+        result.confidence = bandResult.frequency > 0.0f ? juce::jlimit(0.0f, 1.0f, 1.0f - bandResult.confidence) : 0.0f;
+        channel.trackedLag = 0.0f;
+    }
+    else if (detector != Detector::yin)
+    {
+        // Same RMS gate as YIN; nothing is tracked, so switching back to YIN starts with a full pass
+        channel.trackedLag = 0.0f;
+
+        if (result.rms >= silenceGate)
+        {
+            auto& backend = detector == Detector::mpm ? static_cast<PitchDetector&>(channel.mcleodDetector)
+                          : detector == Detector::swipe ? static_cast<PitchDetector&>(channel.swipeDetector)
+                          : channel.perceptualDetector;
+            const auto estimate = backend.detect(samples, snapshot.numSamples);
+            result.frequency = estimate.frequency;
+            result.confidence = estimate.confidence;
+        }
+
+        recordDetectorCost(detector, startTicks);
+    }
+    else if (pitchTracking.load(std::memory_order_relaxed))
+    {
+        // Counts its own passes
+        result.frequency = analyseTracked(channel, snapshot, channelIndex, result.rms);
+        result.confidence = channel.confidence;
+        recordDetectorCost(Detector::yin, startTicks);
+        return result;
+    }
+    else
+    {
+        result.frequency = verifyPitchYIN(channel, snapshot, channelIndex, result.rms);
+
+        if (result.frequency > 0.0f)
+        {
+            verifiedFrames.fetch_add(1, std::memory_order_relaxed);
+            result.confidence = channel.confidence;
+            recordDetectorCost(Detector::yin, startTicks);
+            return result;
+        }
+
+        result.frequency = detectPitchYIN(channel, channel.processingBuffer.data(), snapshot.numSamples);
+        result.confidence = channel.confidence;
+        trackPitch(channel, snapshot, channelIndex, result.frequency, result.rms);
+        recordDetectorCost(Detector::yin, startTicks);
+    }
+
+    fullPasses.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+PitchDetectionEngine::Result PitchDetectionEngine::analysePolyphonic(const Snapshot& snapshot, PolyphonicFrame& frame, int channelIndex)
+{
+    jassert(snapshot.numSamples == snapBufferSize(snapshot.numSamples) && juce::isPositiveAndBelow(channelIndex, snapshot.numChannels));
+
+    auto& channel = *channelAnalysis[static_cast<size_t>(channelIndex)];
+    const float* samples = snapshot.getChannel(channelIndex);
+
+    if (channel.frameLength != snapshot.numSamples)
+        configureChannel(channel, snapshot.numSamples);
+
+    Result result;
+    frame.numVoices = 0;
+    frame.timeInSeconds = snapshot.timeInSeconds;
+    channel.trackedLag = 0.0f;
+
+    if (isBelowGate(snapshot, channelIndex, polyphonicGateHeadroom))
+    {
+        skippedFrames.fetch_add(1, std::memory_order_relaxed);
+        result.rms = snapshot.levels[channelIndex];
+        return result;
+    }
+
+    // Same level measure as analyse(), so velocities match between modes
+    result.rms = measureLevel(channel, snapshot, samples);
+
+    channel.polyphonicDetector.detect(samples, snapshot.numSamples, frame);
+    result.frequency = frame.numVoices > 0 ? frame.frequency[0] : 0.0f;
+    fullPasses.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+void PitchDetectionEngine::trackPitch(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float frequency, float rms)
+{
+    // The incremental method is already cheap per hop, so only the FFT and direct paths are tracked
+    if (!adaptiveScheduling.load(std::memory_order_relaxed) || frequency <= 0.0f
+        || differenceMethod.load(std::memory_order_relaxed) == DifferenceMethod::incremental)
+    {
+        channel.trackedLag = 0.0f;
+        return;
+    }
+
+    // Measured on the unwindowed frame, where a steady tone gives a value near zero at any lag
+    const int numSamples = snapshot.numSamples;
+    const float totalEnergy = snapshot.levels[channelIndex] * snapshot.levels[channelIndex] * numSamples;
+
+    channel.trackedLag = static_cast<float>(sampleRate / frequency);
+    channel.trackedAperiodicity = Core::normalisedDifference(snapshot.getChannel(channelIndex), numSamples, juce::roundToInt(channel.trackedLag), totalEnergy);
+    channel.trackedLevel = rms;
+    channel.framesSinceFullPass = 0;
+}
+
+float PitchDetectionEngine::verifyPitchYIN(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float rms, float threshold)
+{
+    // Returns 0 whenever a full pass is needed instead
+    if (channel.trackedLag <= 0.0f || channel.trackedAperiodicity > confidentAperiodicity
+        || channel.framesSinceFullPass >= maxVerifiedFrames
+        || rms > channel.trackedLevel * levelTolerance || rms * levelTolerance < channel.trackedLevel)
+        return 0.0f;
+
+    const float* x = snapshot.getChannel(channelIndex);
+    const int numSamples = snapshot.numSamples;
+    const float totalEnergy = snapshot.levels[channelIndex] * snapshot.levels[channelIndex] * numSamples;
+
+    // Same search limits as detectPitchYIN, narrowed to about a quarter tone either side
+    const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0));
+    const int maxTau = juce::jmin(numSamples / 2 - 2, static_cast<int>(sampleRate / 70.0));
+    const int centre = juce::roundToInt(channel.trackedLag);
+    const int radius = juce::jmax(2, centre / 32);
+    const int lo = juce::jmax(minTau, centre - radius);
+    const int hi = juce::jmin(maxTau, centre + radius);
+
+    if (hi - lo < 2)
+        return 0.0f;
+
+    // A dip around half the lag means YIN's first-dip rule could now land an octave higher. Even a
+    // shallow one counts: a frame straddling an octave jump only half repeats at the new period.
+    for (int tau = juce::jmax(minTau, centre / 2 - radius / 2 - 1); tau <= juce::jmin(maxTau, centre / 2 + radius / 2 + 1); ++tau)
+        if (Core::normalisedDifference(x, numSamples, tau, totalEnergy) < octaveGuard)
+            return 0.0f;
+
+    float* values = channel.differenceBuffer.data();
+    int bestTau = lo;
+
+    for (int tau = lo; tau <= hi; ++tau)
+    {
+        values[tau] = Core::normalisedDifference(x, numSamples, tau, totalEnergy);
+        if (values[tau] < values[bestTau])
+            bestTau = tau;
+    }
+
+    // The period left the band, or the frame is no longer as periodic as the one that was tracked
+    if (bestTau == lo || bestTau == hi || values[bestTau] > juce::jmin(threshold, channel.trackedAperiodicity * 2.0f + 0.02f))
+        return 0.0f;
+
+    float refinedTau = static_cast<float>(bestTau);
+    const float denom = values[bestTau - 1] - 2.0f * values[bestTau] + values[bestTau + 1];
+    if (std::abs(denom) > 0.0001f)
+        refinedTau += juce::jlimit(-1.0f, 1.0f, 0.5f * (values[bestTau - 1] - values[bestTau + 1]) / denom);
+
+    channel.trackedLag = refinedTau;
+    channel.confidence = juce::jlimit(0.0f, 1.0f, 1.0f - values[bestTau]);
+    ++channel.framesSinceFullPass;
+
+    const float frequency = static_cast<float>(sampleRate / refinedTau);
+    return (frequency >= 16.0f && frequency <= 26000.0f) ? frequency : 0.0f;
+}
+
+float PitchDetectionEngine::analyseTracked(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float rms, float threshold)
+{
+    PitchTracker::Observation observation;
+
+    if (searchAroundTrackedLag(channel, snapshot.numSamples, rms, observation, threshold))
+    {
+        verifiedFrames.fetch_add(1, std::memory_order_relaxed);
+        ++channel.framesSinceFullPass;
+    }
+    else
+    {
+        // Full search over every lag, on the same curve the narrowed search scores
+        observation.numCandidates = 0;
+        channel.curveLength = 0;
+
+        if (rms >= silenceGate)
+        {
+            const int numSamples = snapshot.numSamples;
+            const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0));
+            const int maxTau = juce::jmin(numSamples / 2 - 2, static_cast<int>(sampleRate / 70.0));
+            float* values = channel.differenceBuffer.data();
+
+            computeNormalisedDifference(channel, channel.processingBuffer.data(), numSamples, values, maxTau + 2);
+            channel.pitchTracker.addCandidates(values, minTau - 1, maxTau + 1, sampleRate, observation);
+        }
+
+        fullPasses.fetch_add(1, std::memory_order_relaxed);
+        channel.framesSinceFullPass = 0;
+    }
+
+    channel.pitchTracker.finishObservation(observation);
+
+    float voicing = 0.0f;
+    for (int i = 0; i < observation.numCandidates; ++i)
+        voicing += observation.candidates[i].probability;
+
+    channel.confidence = juce::jmin(1.0f, voicing);
+    const float frequency = channel.pitchTracker.process(observation);
+
+    channel.trackedLag = frequency > 0.0f ? static_cast<float>(sampleRate / frequency) : 0.0f;
+    return frequency;
+}
+
+bool PitchDetectionEngine::searchAroundTrackedLag(ChannelAnalysis& channel, int numSamples, float rms,
+                                                  PitchTracker::Observation& observation, float threshold)
+{
+    // Returns false (and leaves a partial observation) whenever a full search is needed instead
+    if (channel.trackedLag <= 0.0f || channel.framesSinceFullPass >= maxVerifiedFrames)
+        return false;
+
+    // The windowed frame, as in the full search: the taper makes long lags overlap less, which
+    // keeps a noisy frame's octave-down dip from outscoring the period itself
+    const float* x = channel.processingBuffer.data();
+    const float totalEnergy = rms * rms * numSamples;
+    float* values = channel.differenceBuffer.data();
+
+    const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0));
+    const int maxTau = juce::jmin(numSamples / 2 - 2, static_cast<int>(sampleRate / 70.0));
+    const int centre = juce::roundToInt(channel.trackedLag);
+
+    // Half, same and double the period, each about a quarter tone wide, scanned in lag order
+    bool supported = false;
+    for (int multiple = 1; multiple <= 4; multiple *= 2)
+    {
+        const int lag = centre * multiple / 2;
+        const int radius = juce::jmax(2, lag / 32);
+        const int lo = juce::jmax(minTau - 1, lag - radius);
+        const int hi = juce::jmin(maxTau + 1, lag + radius);
+
+        if (hi - lo < 2)
+            continue;
+
+        for (int tau = lo; tau <= hi; ++tau)
+            values[tau] = Core::normalisedDifference(x, numSamples, tau, totalEnergy);
+
+        channel.pitchTracker.addCandidates(values, lo, hi, sampleRate, observation);
+
+        // The tracked period itself has to show a clear dip inside its window
+        if (multiple == 2)
+            for (int tau = lo + 1; tau < hi && !supported; ++tau)
+                supported = values[tau] < threshold && values[tau] < values[tau - 1] && values[tau] <= values[tau + 1];
+    }
+
+    return supported;
+}
+
+float PitchDetectionEngine::detectPitchYIN(ChannelAnalysis& channel, const float* buffer, int numSamples, float threshold)
+{
+    // RMS gate over the whole frame (vectorised, so no need to subsample)
+    const float rms = Core::rms(buffer, numSamples);
+    channel.curveLength = 0;
+    channel.confidence = 0.0f;
+
+    if (rms < silenceGate) // Raised threshold for quieter signals
+        return 0.0f;
+
+    const int halfSize = numSamples / 2;
+    jassert(static_cast<int>(channel.differenceBuffer.size()) >= halfSize);
+    float* diff = channel.differenceBuffer.data();
+
+    // Only the lags the search below can reach; CMND at a lag depends on the lags beneath it alone
+    int numLags = juce::jmin(halfSize, static_cast<int>(sampleRate / 70.0) + 2);
+
+    switch (differenceMethod.load(std::memory_order_relaxed))
+    {
+        case DifferenceMethod::fft:
+            computeDifferenceFFT(channel, buffer, numSamples, diff, numLags);
+            break;
+
+        case DifferenceMethod::direct:
+            computeDifferenceDirect(buffer, numSamples, diff, numLags);
+            break;
+
+        case DifferenceMethod::incremental:
+            numLags = juce::jmin(numLags, channel.slidingDifference.getNumLags());
+            std::copy(channel.slidingDifference.getDifference(), channel.slidingDifference.getDifference() + numLags, diff);
+            break;
+    }
+
+    // Cumulative mean normalized difference
+    Core::cumulativeMeanNormalise(diff, numLags);
+    channel.curveLength = numLags;
+
+    // Optimized search range for human voice/instruments (70 Hz - 1200 Hz)
+    // For guitar down to E2 (82 Hz), use /60.0 for maxTau
+    const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0)); // Up to C7
+    const int maxTau = juce::jmin(numLags - 2, static_cast<int>(sampleRate / 70.0)); // Down to G1
+
+    const float refinedTau = Core::findPeriod(diff, numLags, minTau, maxTau, threshold);
+    if (refinedTau <= 0.0f)
+        return 0.0f;
+
+    channel.confidence = juce::jlimit(0.0f, 1.0f, 1.0f - diff[juce::roundToInt(refinedTau)]);
+
+    const float frequency = static_cast<float>(sampleRate / refinedTau);
+    return (frequency >= 16.0f && frequency <= 26000.0f) ? frequency : 0.0f;
+}
+
+void PitchDetectionEngine::computeDifferenceDirect(const float* buffer, int numSamples, float* diff, int numLags) const
+{
+    // Standard YIN: full overlap for each tau, in cache-sized blocks of lags. On a long frame each
+    // block is a task for the runner, so the blocks are evaluated on several threads at once.
+    auto* runner = taskRunner.load(std::memory_order_relaxed);
+    const int numBlocks = (numLags + Core::lagsPerBlock - 1) / Core::lagsPerBlock;
+
+    if (runner == nullptr || numBlocks < 2 || static_cast<juce::int64>(numSamples) * numLags < minParallelProducts)
+    {
+        Core::differenceDirectTiled(buffer, numSamples, diff, 0, numLags);
+        return;
+    }
+
+    struct Frame
+    {
+        const float* buffer;
+        int numSamples;
+        float* diff;
+        int numLags;
+    };
+
+    Frame frame{ buffer, numSamples, diff, numLags };
+
+    runner->run(numBlocks, [](void* context, int block)
+        {
+            const auto& f = *static_cast<const Frame*>(context);
+            const int begin = block * Core::lagsPerBlock;
+            Core::differenceDirectTiled(f.buffer, f.numSamples, f.diff, begin, juce::jmin(f.numLags, begin + Core::lagsPerBlock));
+        }, &frame);
+}
+
+void PitchDetectionEngine::computeNormalisedDifference(ChannelAnalysis& channel, const float* x, int numSamples, float* values, int numLags)
+{
+    // Core::normalisedDifference for every lag at FFT cost: the energy of the two overlapping parts
+    // is the same prefix-sum term computeDifferenceFFT subtracts 2 r(tau) from
+    computeDifferenceFFT(channel, x, numSamples, values, numLags);
+
+    const auto& energyPrefix = channel.energyPrefix;
+    const double totalEnergy = energyPrefix[numSamples];
+
+    for (int tau = 0; tau < numLags; ++tau)
+    {
+        const double energy = energyPrefix[numSamples - tau] + (totalEnergy - energyPrefix[tau]);
+        values[tau] = energy > 0.0 ? static_cast<float>(values[tau] / energy) : 1.0f;
+    }
+}
+
+void PitchDetectionEngine::computeDifferenceFFT(ChannelAnalysis& channel, const float* buffer, int numSamples, float* diff, int numLags)
+{
+    // d(tau) = sum_{i < N-tau} x[i]^2 + sum_{i >= tau} x[i]^2 - 2 r(tau)
+    // r(tau) comes from the inverse FFT of the power spectrum, the energy terms from a prefix sum
+    auto& energyPrefix = channel.energyPrefix;
+    const auto& differenceFFT = differenceFFTs[static_cast<size_t>(differenceFFTOrder(numSamples) - differenceFFTOrder(minBufferSize))];
+    const int fftSize = differenceFFT->getSize();
+    float* work = channel.fftWorkspace.data();
+
+    std::copy(buffer, buffer + numSamples, work);
+    std::fill(work + numSamples, work + fftSize * 2, 0.0f);
+
+    differenceFFT->performRealOnlyForwardTransform(work);
+
+    // Power spectrum in place (interleaved re/im)
+    for (int k = 0; k < fftSize; ++k)
+    {
+        const float re = work[2 * k];
+        const float im = work[2 * k + 1];
+        work[2 * k] = re * re + im * im;
+        work[2 * k + 1] = 0.0f;
+    }
+
+    differenceFFT->performRealOnlyInverseTransform(work);
+
+    energyPrefix[0] = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+        energyPrefix[i + 1] = energyPrefix[i] + static_cast<double>(buffer[i]) * buffer[i];
+
+    const double totalEnergy = energyPrefix[numSamples];
+
+    for (int tau = 0; tau < numLags; ++tau)
+    {
+        const double energy = energyPrefix[numSamples - tau] + (totalEnergy - energyPrefix[tau]);
+        diff[tau] = juce::jmax(0.0f, static_cast<float>(energy - 2.0 * work[tau]));
+    }
+}
\ No newline at end of file
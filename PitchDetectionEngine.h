@@ -0,0 +1,313 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdKernels.h"
+#include "SlidingDifference.h"
+#include "MultiResolutionDetector.h"
+#include "PolyphonicDetector.h"
+#include "PitchTracker.h"
+#include "McLeodDetector.h"
+#include "SwipeDetector.h"
+#include "PerceptualDetector.h"
+
+// Host-independent pitch detection core
+//
+// Collection side (one thread, e.g. the audio callback): DC blocker, circular analysis buffer,
+// hop counter and snapshotting. Analysis side (one thread, e.g. a worker): windowing and the YIN
+// or band-split detectors. The plugin runs the two sides on different threads and hands snapshots
+// across; processOffline() runs both synchronously for batch work.
+//
+// Up to maxChannels channels are tracked independently. Collection state is kept
+// structure-of-arrays (one buffer plane and DC state per channel, one shared write position and
+// hop counter), so a single pass over a block updates every channel. Each channel has its own
+// analysis state, so different channels may be analysed on different threads at once.
+//
+// Adaptive scheduling (off by default): collection keeps a running energy per channel, so frames
+// below the RMS gate are skipped before any copy or windowing, and a sudden rise in level brings
+// the next hop forward. A channel whose last YIN estimate was confident and whose level has not
+// moved is only re-checked over a narrow band of lags around the tracked period.
+//
+// Pitch tracking (off by default) replaces YIN's per-frame decision with HMM smoothing across
+// frames (see PitchTracker). The tracker always scores the normalised difference of the windowed
+// frame: while the last smoothed pitch is still supported, only around its period and the octaves
+// either side, and over every lag (through the FFT) only when that support drops.
+//
+// Window and hop sizes can change while running: everything is allocated for maxBufferSize in
+// prepare(), Hann windows for every supported size are built once and shared, and the circular
+// buffer always holds maxBufferSize samples, so a new window size just reads more or less of the
+// same history. setAnalysisSize() takes effect at the next hop boundary.
+//
+// The single-pitch detector is YIN by default. McLeod (MPM), a SWIPE-style spectral estimator and a
+// perceptual one (loudness-weighted constant-Q salience) can be chosen instead with setDetector();
+// they sit behind the PitchDetector interface, take the unwindowed frame and replace the YIN
+// decision only, so adaptive verification and pitch tracking (which work on YIN's difference
+// curve) stay YIN-only and are bypassed while another detector is selected. Every Result carries
+// the chosen detector's confidence, and each detector's frame count and mean time per frame are
+// kept for comparison (getDetectorStats()).
+//
+// YIN only evaluates the lags its period search can reach (70 Hz at most), whatever the window
+// size. The direct difference function works through them in cache-sized blocks of lags tiled over
+// the frame; on long frames the blocks are handed to an optional TaskRunner so one frame can use
+// several cores, and the CMND scan and period pick then run over the merged curve.
+//
+// The YIN reductions (RMS gate, direct difference, CMND, normalised difference) go through
+// YinCore, whose float / double / pairwise accumulation is chosen at compile time with
+// PITCHDETECTOR_ACCUMULATION. The FFT correlation itself is always float.
+class PitchDetectionEngine
+{
+public:
+    // YIN difference function strategy
+    // FFT computes d(tau) via autocorrelation in O(N log N); Direct is the original tau x i loop, kept for A/B accuracy checks
+    // Incremental keeps per-hop lag products (unwindowed, fixed integration window) so cost scales with hop size
+    enum class DifferenceMethod { fft, direct, incremental };
+
+    // Single-pitch detector behind analyse()
+    enum class Detector { yin, mpm, swipe, perceptual };
+    static constexpr int numDetectors = 4;
+
+    static constexpr int maxChannels = 16;
+    static constexpr int minBufferSize = 2048;
+    static constexpr int maxBufferSize = 16384;
+    static constexpr int bufferSizeStep = 256;   // window sizes are rounded to a multiple of this
+    static constexpr float silenceGate = 0.01f;  // RMS below which a frame is treated as unvoiced
+
+    // Lets one frame's direct difference function be spread over several threads (see setTaskRunner())
+    class TaskRunner
+    {
+    public:
+        virtual ~TaskRunner() = default;
+
+        // Runs task(context, 0 .. numTasks - 1), in any order and on any threads, returning once all are done
+        virtual void run(int numTasks, void (*task)(void*, int), void* context) = 0;
+    };
+
+    // Copy of the analysis buffers (oldest to newest) at the moment a hop completed, one plane per channel
+    struct Snapshot
+    {
+        std::vector<float> samples;
+        int numSamples = 0;
+        int numChannels = 0;
+        double timeInSeconds = 0.0;
+        juce::int64 endSamplePosition = 0;
+        std::array<float, maxChannels> levels{};  // running (unwindowed) RMS of each plane
+        bool hasSamples = true;                   // false when every channel was silent and the copy was skipped
+
+        const float* getChannel(int channel) const { return samples.data() + static_cast<size_t>(channel) * numSamples; }
+    };
+
+    struct Result
+    {
+        float frequency = 0.0f; // 0 when unvoiced or below the RMS gate
+        float rms = 0.0f;       // of the windowed frame (the unwindowed level when the frame was skipped)
+        float confidence = 0.0f; // 0..1 from the detector that decided frequency, 0 when gated
+    };
+
+    // Per channel-frame counts since the last resetSchedulingStats()
+    struct SchedulingStats
+    {
+        int fullPasses = 0;
+        int verifiedFrames = 0;  // narrow-lag search around the tracked pitch was enough
+        int skippedFrames = 0;   // below the gate, nothing analysed
+        int onsetHops = 0;       // hops brought forward by a rise in level
+    };
+
+    // Frames a detector decided and their mean cost (windowing excluded), since the last resetSchedulingStats()
+    struct DetectorStats
+    {
+        int frames = 0;
+        double meanMicroseconds = 0.0;
+    };
+
+    PitchDetectionEngine();
+
+    // Not real-time safe; history is kept if the channel count is unchanged
+    void prepare(double newSampleRate, int newBufferSize, int newHopSize, int newNumChannels = 1);
+    void reset();
+    void prepareSnapshot(Snapshot& snapshot) const;
+
+    // Nearest supported window size
+    static int snapBufferSize(int size);
+
+    double getSampleRate() const { return sampleRate; }
+    int getBufferSize() const { return bufferSize.load(std::memory_order_relaxed); }
+    int getHopSize() const { return hopSize.load(std::memory_order_relaxed); }
+    int getNumChannels() const { return numChannels; }
+
+    void setDifferenceMethod(DifferenceMethod method) { differenceMethod.store(method, std::memory_order_relaxed); }
+    DifferenceMethod getDifferenceMethod() const { return differenceMethod.load(std::memory_order_relaxed); }
+
+    void setMultiResolution(bool shouldUse) { multiResolution.store(shouldUse, std::memory_order_relaxed); }
+    bool isMultiResolution() const { return multiResolution.load(std::memory_order_relaxed); }
+
+    void setAdaptiveScheduling(bool shouldUse) { adaptiveScheduling.store(shouldUse, std::memory_order_relaxed); }
+    bool isAdaptiveScheduling() const { return adaptiveScheduling.load(std::memory_order_relaxed); }
+
+    void setPitchTracking(bool shouldTrack) { pitchTracking.store(shouldTrack, std::memory_order_relaxed); }
+    bool isPitchTracking() const { return pitchTracking.load(std::memory_order_relaxed); }
+
+    // Optional; without one every frame is analysed on the calling thread alone
+    void setTaskRunner(TaskRunner* runner) { taskRunner.store(runner, std::memory_order_relaxed); }
+
+    void setDetector(Detector detector) { selectedDetector.store(detector, std::memory_order_relaxed); }
+    Detector getDetector() const { return selectedDetector.load(std::memory_order_relaxed); }
+
+    SchedulingStats getSchedulingStats() const;
+    DetectorStats getDetectorStats(Detector detector) const;
+    void resetSchedulingStats();
+
+    //==============================================================================
+    // Collection side
+
+    // Real-time safe; applied at the next hop boundary, so that hop's snapshot already has the new size.
+    // The window size is snapped with snapBufferSize().
+    void setAnalysisSize(int newBufferSize, int newHopSize);
+
+    // Never more than one hop away (less after an onset); collect() at most this many samples to land exactly on hop boundaries
+    int getSamplesUntilNextHop() const { return samplesUntilNextHop; }
+
+    // Returns true if these samples completed a hop and the buffer holds a full window.
+    // channelData holds getNumChannels() pointers, read from startSample onwards.
+    bool collect(const float* const* channelData, int startSample, int numSamples);
+
+    // Single-channel convenience
+    bool collect(const float* samples, int numSamples) { return collect(&samples, 0, numSamples); }
+
+    void takeSnapshot(Snapshot& snapshot) const;
+    juce::int64 getSamplePosition() const { return samplePosition; }
+
+    //==============================================================================
+    // Analysis side
+    // Different channels may be analysed concurrently; one channel only from one thread at a time
+    Result analyse(const Snapshot& snapshot, int channel = 0);
+
+    // Multiple-F0 analysis instead of YIN; the returned frequency is the strongest voice
+    Result analysePolyphonic(const Snapshot& snapshot, PolyphonicFrame& frame, int channel = 0);
+    void setMaxVoices(int maxVoices);
+
+    //==============================================================================
+    // Runs collection and analysis back to back, calling onFrame(const Snapshot&, const Result&) for every hop
+    template <typename Callback>
+    void processOffline(const float* samples, int numSamples, Snapshot& scratch, Callback&& onFrame)
+    {
+        while (numSamples > 0)
+        {
+            // Quarter-window pieces, so an onset can still bring the next hop forward
+            const int chunk = juce::jmin(numSamples, samplesUntilNextHop, juce::jmax(1, getBufferSize() / 4));
+
+            if (collect(samples, chunk))
+            {
+                takeSnapshot(scratch);
+                onFrame(static_cast<const Snapshot&>(scratch), analyse(scratch));
+            }
+
+            samples += chunk;
+            numSamples -= chunk;
+        }
+    }
+
+    // The same for all getNumChannels() channels (channelData holds a pointer per channel), calling
+    // onFrame(const Snapshot&, int channel, const Result&) for every channel of every hop
+    template <typename Callback>
+    void processOffline(const float* const* channelData, int numSamples, Snapshot& scratch, Callback&& onFrame)
+    {
+        for (int start = 0; start < numSamples;)
+        {
+            const int chunk = juce::jmin(numSamples - start, samplesUntilNextHop, juce::jmax(1, getBufferSize() / 4));
+
+            if (collect(channelData, start, chunk))
+            {
+                takeSnapshot(scratch);
+
+                for (int channel = 0; channel < scratch.numChannels; ++channel)
+                    onFrame(static_cast<const Snapshot&>(scratch), channel, analyse(scratch, channel));
+            }
+
+            start += chunk;
+        }
+    }
+
+private:
+    // Everything one channel's analysis writes to
+    struct ChannelAnalysis
+    {
+        std::vector<float> processingBuffer;
+        std::vector<float> differenceBuffer;
+        std::vector<float> fftWorkspace;
+        std::vector<double> energyPrefix;
+        int curveLength = 0;  // lags of differenceBuffer holding the last full CMND curve, 0 when gated
+        int frameLength = 0;  // snapshot size the sliding and polyphonic state are set up for
+
+        // Adaptive scheduling: the last confident YIN estimate (trackedLag is 0 when there is none)
+        float trackedLag = 0.0f;
+        float trackedAperiodicity = 1.0f;
+        float trackedLevel = 0.0f;
+        int framesSinceFullPass = 0;
+
+        float confidence = 0.0f;  // of the last YIN decision: 1 minus the dip it took, or the tracker's voicing probability
+
+        SlidingDifference slidingDifference;
+        MultiResolutionDetector multiResolutionDetector;
+        PolyphonicDetector polyphonicDetector;
+        PitchTracker pitchTracker;
+        McLeodDetector mcleodDetector;
+        SwipeDetector swipeDetector;
+        PerceptualDetector perceptualDetector;
+    };
+
+    float detectPitchYIN(ChannelAnalysis& channel, const float* buffer, int numSamples, float threshold = 0.15f);
+    void computeDifferenceDirect(const float* buffer, int numSamples, float* diff, int numLags) const;
+    void computeDifferenceFFT(ChannelAnalysis& channel, const float* buffer, int numSamples, float* diff, int numLags);
+    void computeNormalisedDifference(ChannelAnalysis& channel, const float* x, int numSamples, float* values, int numLags);
+    void configureChannel(ChannelAnalysis& channel, int numSamples);
+    void applyPendingSize();
+    void sumWindowEnergies();
+    float measureLevel(ChannelAnalysis& channel, const Snapshot& snapshot, const float* samples);
+    bool isBelowGate(const Snapshot& snapshot, int channel, float headroom = 1.0f) const;
+    void trackPitch(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float frequency, float rms);
+    float verifyPitchYIN(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float rms, float threshold = 0.15f);
+    void updateOnsetDetector(int samplesLeftInCall);
+    void recordDetectorCost(Detector detector, juce::int64 startTicks);
+    float analyseTracked(ChannelAnalysis& channel, const Snapshot& snapshot, int channelIndex, float rms, float threshold = 0.15f);
+    bool searchAroundTrackedLag(ChannelAnalysis& channel, int numSamples, float rms,
+                                PitchTracker::Observation& observation, float threshold);
+
+    double sampleRate = 48000.0;
+    std::atomic<int> bufferSize{ 0 };  // written by the collection side only
+    std::atomic<int> hopSize{ 0 };
+    int numChannels = 0;
+    int maxVoices = 4;
+
+    std::atomic<DifferenceMethod> differenceMethod{ DifferenceMethod::fft };
+    std::atomic<bool> multiResolution{ false };
+    std::atomic<bool> adaptiveScheduling{ false };
+    std::atomic<bool> pitchTracking{ false };
+    std::atomic<Detector> selectedDetector{ Detector::yin };
+    std::atomic<TaskRunner*> taskRunner{ nullptr };
+
+    // Collection state: one maxBufferSize plane per channel, shared position and hop counter
+    std::vector<float> analysisBuffer;
+    int writePosition = 0;
+    int samplesCollected = 0;  // since the last reset, up to maxBufferSize
+    int samplesUntilNextHop = 1;
+    int pendingBufferSize = 0;
+    int pendingHopSize = 0;
+    juce::int64 samplePosition = 0;
+    std::array<float, maxChannels> dcBlockerX{};
+    std::array<float, maxChannels> dcBlockerY{};
+
+    // Running sum of squares over each channel's newest bufferSize samples, plus the level of the segment being collected
+    std::array<double, maxChannels> windowEnergy{};
+    std::array<double, maxChannels> segmentEnergy{};
+    int segmentLength = 0;
+    bool onsetPending = false;
+
+    std::atomic<int> fullPasses{ 0 }, verifiedFrames{ 0 }, skippedFrames{ 0 }, onsetHops{ 0 };
+    std::array<std::atomic<int>, numDetectors> detectorFrames{};
+    std::array<std::atomic<juce::int64>, numDetectors> detectorTicks{};
+
+    // Analysis state (read-only after prepare() unless per channel)
+    std::vector<std::unique_ptr<juce::dsp::FFT>> differenceFFTs;  // one per FFT order any window size needs; perform calls are const
+    std::vector<std::unique_ptr<ChannelAnalysis>> channelAnalysis;
+
+    JUCE_DECLARE_NON_COPYABLE(PitchDetectionEngine)
+};
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Interface for single-pitch detectors that work on one windowed frame at a time
+//
+// prepare() allocates everything for every frame length up to maxFrameLength; setFrameLength()
+// and detect() only pick and use those tables, so they are safe on the analysis thread. Each
+// instance holds one channel's state, so different channels need different instances.
+class PitchDetector
+{
+public:
+    struct Estimate
+    {
+        float frequency = 0.0f;   // 0 when unvoiced
+        float confidence = 0.0f;  // 0..1, detector-specific; reported even when unvoiced
+    };
+
+    virtual ~PitchDetector() = default;
+
+    virtual const char* getName() const = 0;
+
+    // Not real-time safe
+    virtual void prepare(double sampleRate, int minFrameLength, int maxFrameLength) = 0;
+
+    virtual void setFrameLength(int frameLength) = 0;
+
+    // samples holds the current frame length of unwindowed samples, oldest to newest; each detector
+    // applies whatever window (if any) its method needs
+    virtual Estimate detect(const float* samples, int numSamples) = 0;
+};
\ No newline at end of file
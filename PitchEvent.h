@@ -0,0 +1,17 @@
+#pragma once
+
+// One entry in the pitch log
+//
+// Logged when the detected note changes and periodically while it is held. An entry with
+// midiNote < 0 (frequency 0) marks the point where the input went unvoiced. Every input channel
+// is logged as a track of its own, interleaved by time.
+struct PitchEvent
+{
+    double timeInSeconds;
+    float frequency;
+    int midiNote;
+    float velocity;
+    int channel = 0;  // input channel the pitch was detected on
+
+    bool isRest() const { return midiNote < 0; }
+};
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "PitchGraph.h"
+#include "PluginProcessor.h"
+
+namespace
+{
+    const juce::Colour editorBackground(0xff1a1a1a);
+    const juce::Colour plotBackground(0xff0a0a0a);
+    const juce::Colour gridColour(0xff2a2a2a);
+
+    constexpr int labelHeight = 15;                  // event count above the plot, time axis below
+    constexpr int maxEventsPerUpdate = 32768;        // opening the editor on a long log catches up over a few frames
+}
+
+PitchGraph::PitchGraph(PitchDetectorAudioProcessor& p)
+    : audioProcessor(p)
+{
+    setOpaque(true);
+    setInterceptsMouseClicks(false, false);
+}
+
+void PitchGraph::resized()
+{
+    plotArea = getLocalBounds().withTrimmedTop(labelHeight).withTrimmedBottom(labelHeight - 1);
+    plotImage = juce::Image(juce::Image::RGB, juce::jmax(1, plotArea.getWidth()), juce::jmax(1, plotArea.getHeight()), true);
+    columns.assign(static_cast<size_t>(juce::jmax(1, plotArea.getWidth())), Column{});
+
+    // The summary depends on the width, so it is rebuilt from the start of the log
+    reset();
+}
+
+void PitchGraph::reset()
+{
+    std::fill(columns.begin(), columns.end(), Column{});
+    secondsPerColumn = 1.0 / static_cast<double>(columns.size());  // one second across to begin with
+    eventsRead = 0;
+    previousTime = -1.0;
+    previousVoiced = false;
+    lastVoicedColumn = -1;
+    dirtyFirst = 0;
+    dirtyLast = -1;
+    fullRedraw = true;
+}
+
+void PitchGraph::update()
+{
+    const auto& log = audioProcessor.getPitchLog();
+    const int generation = log.getGeneration();
+    if (generation != logGeneration)
+    {
+        logGeneration = generation;
+        reset();
+    }
+
+    const bool wasEmpty = eventsRead == 0;
+
+    const int lastEvent = eventsRead + maxEventsPerUpdate;
+
+    log.visit(eventsRead, [this, lastEvent](const PitchEvent* events, int numEvents)
+        {
+            const int count = juce::jmin(numEvents, lastEvent - eventsRead);
+
+            for (int i = 0; i < count; ++i)
+                addEvent(events[i]);
+
+            eventsRead += count;
+            return eventsRead < lastEvent;
+        });
+
+    // The placeholder text goes with the first event
+    fullRedraw = fullRedraw || (wasEmpty && eventsRead > 0);
+
+    if (fullRedraw)
+    {
+        renderColumns(0, static_cast<int>(columns.size()) - 1);
+        repaint();
+    }
+    else if (dirtyLast >= dirtyFirst)
+    {
+        renderColumns(dirtyFirst, dirtyLast);
+        repaint(getColumnArea(dirtyFirst, dirtyLast).translated(plotArea.getX(), plotArea.getY()));
+        repaint(getLocalBounds().removeFromTop(labelHeight));
+    }
+
+    fullRedraw = false;
+    dirtyFirst = 0;
+    dirtyLast = -1;
+}
+
+void PitchGraph::addEvent(const PitchEvent& event)
+{
+    // Like the note display, the graph follows the first input channel
+    if (event.channel != 0)
+        return;
+
+    // Further voices of a chord share the first voice's timestamp; they are drawn as dots
+    const bool chordVoice = event.timeInSeconds == previousTime;
+    previousTime = event.timeInSeconds;
+
+    // Break the curve where the input went unvoiced
+    if (event.isRest())
+    {
+        previousVoiced = false;
+        return;
+    }
+
+    int index = juce::jmax(0, static_cast<int>(event.timeInSeconds / secondsPerColumn));
+    while (index >= static_cast<int>(columns.size()))
+    {
+        halveResolution();
+        index = static_cast<int>(event.timeInSeconds / secondsPerColumn);
+    }
+
+    auto& column = columns[static_cast<size_t>(index)];
+    const int note = juce::jlimit(0, 127, event.midiNote);
+    int firstChanged = index;
+
+    if (chordVoice)
+    {
+        column.chordNotes.set(static_cast<size_t>(note));
+    }
+    else if (!column.voiced)
+    {
+        column.voiced = true;
+        column.joinFrom = previousVoiced ? lastVoicedColumn : -1;
+        column.firstNote = column.lastNote = column.lowestNote = column.highestNote = note;
+        previousVoiced = true;
+        lastVoicedColumn = index;
+
+        // The joining line crosses every column back to where the curve was last seen
+        if (column.joinFrom >= 0)
+            firstChanged = column.joinFrom;
+    }
+    else
+    {
+        column.lastNote = note;
+        column.lowestNote = juce::jmin(column.lowestNote, note);
+        column.highestNote = juce::jmax(column.highestNote, note);
+        previousVoiced = true;
+        lastVoicedColumn = index;
+    }
+
+    if (dirtyLast < dirtyFirst)
+        dirtyFirst = firstChanged;
+
+    dirtyFirst = juce::jmin(dirtyFirst, firstChanged);
+    dirtyLast = juce::jmax(dirtyLast, index);
+}
+
+void PitchGraph::halveResolution()
+{
+    // Pairs of columns become one; a rest falling between the two is lost at this zoom
+    const int numColumns = static_cast<int>(columns.size());
+
+    for (int i = 0; i < numColumns; ++i)
+    {
+        if (2 * i >= numColumns)
+        {
+            columns[static_cast<size_t>(i)] = Column{};
+            continue;
+        }
+
+        Column merged = columns[static_cast<size_t>(2 * i)];
+        const Column right = 2 * i + 1 < numColumns ? columns[static_cast<size_t>(2 * i + 1)] : Column{};
+
+        if (merged.voiced && right.voiced)
+        {
+            merged.lastNote = right.lastNote;
+            merged.lowestNote = juce::jmin(merged.lowestNote, right.lowestNote);
+            merged.highestNote = juce::jmax(merged.highestNote, right.highestNote);
+        }
+        else if (right.voiced)
+        {
+            const auto chordNotes = merged.chordNotes;
+            merged = right;
+            merged.chordNotes |= chordNotes;
+        }
+
+        if (merged.joinFrom >= 0)
+            merged.joinFrom /= 2;
+
+        merged.chordNotes |= right.chordNotes;
+        columns[static_cast<size_t>(i)] = merged;
+    }
+
+    secondsPerColumn *= 2.0;
+    lastVoicedColumn = lastVoicedColumn >= 0 ? lastVoicedColumn / 2 : -1;
+    fullRedraw = true;
+}
+
+float PitchGraph::noteToY(int note) const
+{
+    return plotImage.getHeight() * (1.0f - note / 127.0f);
+}
+
+juce::Rectangle<int> PitchGraph::getColumnArea(int first, int last) const
+{
+    // In image coordinates, with room for the stroke width either side
+    const int x = juce::jmax(0, first - 2);
+    const int right = juce::jmin(plotImage.getWidth(), last + 3);
+    return { x, 0, right - x, plotImage.getHeight() };
+}
+
+void PitchGraph::renderColumns(int first, int last)
+{
+    const auto area = getColumnArea(first, last);
+    const int numColumns = static_cast<int>(columns.size());
+
+    juce::Graphics g(plotImage);
+    g.reduceClipRegion(area);
+
+    // Background
+    g.setColour(plotBackground);
+    g.fillRect(area);
+
+    if (eventsRead == 0)
+    {
+        g.setColour(juce::Colours::grey);
+        g.drawRect(plotImage.getBounds(), 1);
+        g.setFont(14.0f);
+        g.drawText("Press Record to log pitch data", plotImage.getBounds(), juce::Justification::centred);
+        return;
+    }
+
+    // Draw grid lines (MIDI notes)
+    g.setColour(gridColour);
+    for (int note = 0; note <= 127; note += 12)
+        g.drawHorizontalLine(static_cast<int>(noteToY(note)), static_cast<float>(area.getX()), static_cast<float>(area.getRight()));
+
+    // Neighbours' strokes reach into the cleared area, so they are redrawn too (clipped)
+    for (int i = juce::jmax(0, first - 2); i <= juce::jmin(numColumns - 1, last + 2); ++i)
+    {
+        const auto& column = columns[static_cast<size_t>(i)];
+        const float x = i + 0.5f;
+
+        if (column.voiced)
+        {
+            g.setColour(juce::Colours::cyan);
+
+            if (column.joinFrom >= 0)
+                g.drawLine(column.joinFrom + 0.5f, noteToY(columns[static_cast<size_t>(column.joinFrom)].lastNote),
+                           x, noteToY(column.firstNote), 2.0f);
+
+            const float top = noteToY(column.highestNote);
+            g.fillRect(x - 1.0f, top - 1.0f, 2.0f, noteToY(column.lowestNote) - top + 2.0f);
+        }
+
+        if (column.chordNotes.any())
+        {
+            g.setColour(juce::Colours::cyan.withAlpha(0.7f));
+            for (int note = 0; note < 128; ++note)
+                if (column.chordNotes[static_cast<size_t>(note)])
+                    g.fillEllipse(x - 2.0f, noteToY(note) - 2.0f, 4.0f, 4.0f);
+        }
+    }
+
+    g.setColour(juce::Colours::grey);
+    g.drawRect(plotImage.getBounds(), 1);
+}
+
+void PitchGraph::paint(juce::Graphics& g)
+{
+    g.fillAll(editorBackground);
+    g.drawImageAt(plotImage, plotArea.getX(), plotArea.getY());
+
+    if (eventsRead == 0)
+        return;
+
+    // Draw time markers
+    g.setColour(juce::Colours::lightgrey);
+    g.setFont(10.0f);
+    g.drawText("0s", plotArea.getX(), plotArea.getBottom() + 2, 30, 12, juce::Justification::left);
+    g.drawText(juce::String(secondsPerColumn * static_cast<double>(columns.size()), 1) + "s",
+               plotArea.getRight() - 30, plotArea.getBottom() + 2, 30, 12, juce::Justification::right);
+
+    // Draw note count
+    g.drawText(juce::String(eventsRead) + " events", plotArea.getX(), plotArea.getY() - labelHeight, 100, 12, juce::Justification::left);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <bitset>
+#include "PitchEvent.h"
+
+class PitchDetectorAudioProcessor;
+
+// Whole-recording view of the pitch log for the editor
+//
+// Each update() reads only the log entries added since the previous one and folds them into a
+// per-pixel summary (lowest/highest note, first/last note for joining columns, chord notes).
+// When the recording outgrows the time axis, neighbouring columns are merged and the axis
+// doubles, so the summary never holds more than one entry per pixel. Columns are rendered into a
+// cached image, and only the columns that changed are redrawn and repainted; per-frame cost
+// depends on the width and the number of new events, not on the length of the log.
+class PitchGraph : public juce::Component
+{
+public:
+    explicit PitchGraph(PitchDetectorAudioProcessor& processor);
+
+    // Call from the editor's timer
+    void update();
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    struct Column
+    {
+        bool voiced = false;
+        int joinFrom = -1;           // column the curve runs in from, -1 after a rest
+        int firstNote = 0;
+        int lastNote = 0;
+        int lowestNote = 127;
+        int highestNote = 0;
+        std::bitset<128> chordNotes;  // further voices of a chord, drawn as dots
+    };
+
+    void reset();
+    void addEvent(const PitchEvent& event);
+    void halveResolution();
+    void renderColumns(int first, int last);
+    juce::Rectangle<int> getColumnArea(int first, int last) const;
+    float noteToY(int note) const;
+
+    PitchDetectorAudioProcessor& audioProcessor;
+
+    juce::Rectangle<int> plotArea;   // the graph itself, inside the component's label margins
+    juce::Image plotImage;           // cached rendering of plotArea
+    std::vector<Column> columns;     // one per pixel of plotArea
+    double secondsPerColumn = 0.0;
+
+    int logGeneration = -1;          // of the log the summary was built from
+    int eventsRead = 0;
+    double previousTime = -1.0;
+    bool previousVoiced = false;
+    int lastVoicedColumn = -1;
+
+    int dirtyFirst = 0, dirtyLast = -1;
+    bool fullRedraw = true;
+
+    JUCE_DECLARE_NON_COPYABLE(PitchGraph)
+};
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "PitchLog.h"
+
+namespace
+{
+    // Spill file: "PLOG", format version, then fixed-size records in log order
+    constexpr int spillMagic = 0x474f4c50;
+    constexpr int spillVersion = 2;
+    constexpr int headerSize = 8;
+    constexpr int recordSize = 24;  // time (double), frequency (float), MIDI note (int), velocity (float), channel (int)
+}
+
+PitchLog::PitchLog()
+    : readBack(std::make_unique<PitchEvent[]>(eventsPerChunk))
+{
+}
+
+PitchLog::~PitchLog()
+{
+    spillThread.signalThreadShouldExit();
+    spillThread.notify();
+    spillThread.stopThread(2000);
+
+    spillOutput.reset();
+    spillInput.reset();
+
+    if (spillFile != juce::File())
+        spillFile.deleteFile();
+}
+
+void PitchLog::setSpillFile(const juce::File& file)
+{
+    spillThread.signalThreadShouldExit();
+    spillThread.notify();
+    spillThread.stopThread(2000);
+
+    {
+        const juce::ScopedLock spill(spillLock);
+        RealtimeSafety::CheckedScopedLock lock(logLock);
+
+        resetChunks();
+        spillOutput.reset();
+        spillInput.reset();
+
+        if (spillFile != juce::File())
+            spillFile.deleteFile();
+
+        spillFile = file;
+        spillFailed = false;
+    }
+}
+
+void PitchLog::openSpillFile()
+{
+    // Called on the spill thread with spillLock held
+    spillFile.deleteFile();
+    auto output = std::make_unique<juce::FileOutputStream>(spillFile);
+
+    // Without a file everything simply stays in memory
+    if (!output->openedOk() || !output->writeInt(spillMagic) || !output->writeInt(spillVersion))
+    {
+        spillFailed = true;
+        return;
+    }
+
+    output->flush();
+    spillOutput = std::move(output);
+}
+
+void PitchLog::clear()
+{
+    const juce::ScopedLock spill(spillLock);
+    RealtimeSafety::CheckedScopedLock lock(logLock);
+
+    resetChunks();
+
+    // The file starts over with the next sealed chunk (which also retries after a failure)
+    if (spillFile != juce::File())
+    {
+        spillOutput.reset();
+        spillInput.reset();
+        spillFile.deleteFile();
+        spillFailed = false;
+    }
+}
+
+void PitchLog::resetChunks()
+{
+    for (auto* chunk : chunks)
+        if (chunk != nullptr)
+            freeChunks.push_back(chunk);
+
+    chunks.clear();
+    numEvents.store(0, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_release);
+    spilledChunks = 0;
+    firstResidentChunk = 0;
+    readBackChunk = -1;
+
+    // Keep enough spare chunks for the next take, give the rest of a long one back
+    while (freeChunks.size() > static_cast<size_t>(maxResidentChunks) + 2)
+    {
+        auto* chunk = freeChunks.back();
+        freeChunks.pop_back();
+        storage.erase(std::find_if(storage.begin(), storage.end(), [chunk](const auto& s) { return s.get() == chunk; }));
+    }
+}
+
+PitchEvent* PitchLog::takeFreeChunk()
+{
+    if (freeChunks.empty())
+    {
+        storage.push_back(std::make_unique<PitchEvent[]>(eventsPerChunk));
+        return storage.back().get();
+    }
+
+    auto* chunk = freeChunks.back();
+    freeChunks.pop_back();
+    return chunk;
+}
+
+void PitchLog::append(const PitchEvent* events, int count)
+{
+    bool sealedChunk = false;
+    bool spilling = false;
+
+    {
+        RealtimeSafety::CheckedScopedLock lock(logLock);
+        spilling = spillFile != juce::File();
+        int index = size();
+
+        for (int done = 0; done < count;)
+        {
+            const int offset = index % eventsPerChunk;
+            if (offset == 0)
+                chunks.push_back(takeFreeChunk());
+
+            const int run = juce::jmin(count - done, eventsPerChunk - offset);
+            std::copy(events + done, events + done + run, chunks.back() + offset);
+
+            done += run;
+            index += run;
+            sealedChunk = sealedChunk || index % eventsPerChunk == 0;
+        }
+
+        numEvents.store(index, std::memory_order_release);
+    }
+
+    if (!sealedChunk || !spilling)
+        return;
+
+    // The thread opens the file itself, so nothing touches the disk until there is a chunk to write
+    if (spillThread.isThreadRunning())
+        spillThread.notify();
+    else
+        spillThread.startThread(juce::Thread::Priority::background);
+}
+
+const PitchEvent* PitchLog::getChunk(int chunkIndex) const
+{
+    // Called with logLock held
+    if (chunks[static_cast<size_t>(chunkIndex)] != nullptr)
+        return chunks[static_cast<size_t>(chunkIndex)];
+
+    // Evicted, so it is in the spill file
+    if (readBackChunk != chunkIndex)
+    {
+        readBackChunk = -1;
+
+        if (!readSpilledChunk(chunkIndex))
+            return nullptr;
+
+        readBackChunk = chunkIndex;
+    }
+
+    return readBack.get();
+}
+
+bool PitchLog::readSpilledChunk(int chunkIndex) const
+{
+    if (spillInput == nullptr)
+    {
+        spillInput = std::make_unique<juce::FileInputStream>(spillFile);
+
+        if (spillInput->failedToOpen())
+        {
+            spillInput.reset();
+            return false;
+        }
+    }
+
+    const int chunkBytes = eventsPerChunk * recordSize;
+    readBackBytes.setSize(static_cast<size_t>(chunkBytes));
+
+    if (!spillInput->setPosition(headerSize + static_cast<juce::int64>(chunkIndex) * chunkBytes)
+        || spillInput->read(readBackBytes.getData(), chunkBytes) != chunkBytes)
+        return false;
+
+    juce::MemoryInputStream records(readBackBytes, false);
+
+    for (int i = 0; i < eventsPerChunk; ++i)
+    {
+        auto& event = readBack[i];
+        event.timeInSeconds = records.readDouble();
+        event.frequency = records.readFloat();
+        event.midiNote = records.readInt();
+        event.velocity = records.readFloat();
+        event.channel = records.readInt();
+    }
+
+    return true;
+}
+
+int PitchLog::read(int startIndex, PitchEvent* dest, int maxEvents) const
+{
+    int numCopied = 0;
+
+    visit(startIndex, [&](const PitchEvent* events, int count)
+        {
+            const int run = juce::jmin(count, maxEvents - numCopied);
+            std::copy(events, events + run, dest + numCopied);
+            numCopied += run;
+            return numCopied < maxEvents;
+        });
+
+    return numCopied;
+}
+
+void PitchLog::SpillThread::run()
+{
+    while (!threadShouldExit())
+    {
+        owner.spillSealedChunks();
+        wait(-1);
+    }
+}
+
+void PitchLog::spillSealedChunks()
+{
+    // Chunks are only recycled with spillLock held, so the one being written can't go away meanwhile
+    const juce::ScopedLock spill(spillLock);
+
+    // Only woken once a chunk is sealed, so this is where the file is first created
+    if (spillOutput == nullptr && !spillFailed)
+        openSpillFile();
+
+    for (;;)
+    {
+        const PitchEvent* chunk = nullptr;
+
+        {
+            RealtimeSafety::CheckedScopedLock lock(logLock);
+
+            if (spillOutput == nullptr || spilledChunks >= size() / eventsPerChunk)
+                return;
+
+            chunk = chunks[static_cast<size_t>(spilledChunks)];
+        }
+
+        // Sealed chunks never change, so they are written without holding the log lock
+        bool written = true;
+        for (int i = 0; i < eventsPerChunk; ++i)
+        {
+            const auto& event = chunk[i];
+            written = spillOutput->writeDouble(event.timeInSeconds) && spillOutput->writeFloat(event.frequency)
+                   && spillOutput->writeInt(event.midiNote) && spillOutput->writeFloat(event.velocity)
+                   && spillOutput->writeInt(event.channel) && written;
+        }
+
+        spillOutput->flush();
+
+        RealtimeSafety::CheckedScopedLock lock(logLock);
+
+        // A full disk stops spilling; the log then just keeps growing in memory
+        if (!written || spillOutput->getStatus().failed())
+        {
+            spillOutput.reset();
+            spillFailed = true;
+            return;
+        }
+
+        ++spilledChunks;
+        evictSpilledChunks();
+    }
+}
+
+void PitchLog::evictSpilledChunks()
+{
+    // Keep the newest sealed chunks resident; readers mostly want the end of the log
+    const int sealedChunks = size() / eventsPerChunk;
+
+    while (firstResidentChunk < spilledChunks && sealedChunks - firstResidentChunk > maxResidentChunks)
+    {
+        auto& chunk = chunks[static_cast<size_t>(firstResidentChunk++)];
+        freeChunks.push_back(chunk);
+        chunk = nullptr;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PitchEvent.h"
+#include "RealtimeSafety.h"
+
+// Append-only pitch event log stored in fixed-size chunks
+//
+// The writer appends in O(1); when a chunk fills it is sealed (never written again) and the next
+// one comes from a pool of recycled chunks. With a spill file set, a background thread streams
+// sealed chunks to it as packed little-endian records, after which only the newest
+// maxResidentChunks sealed chunks stay in memory and older ones are read back from the file when
+// visited. Without a spill file every chunk stays resident. The file is only created, and the
+// thread only started, once the first chunk is sealed, so a log that never fills one costs neither.
+// Readers walk the log as spans of consecutive events (visit()) instead of taking a copy.
+class PitchLog
+{
+public:
+    static constexpr int eventsPerChunk = 4096;
+    static constexpr int maxResidentChunks = 16;  // sealed chunks kept in memory once spilled, about 1.5 MB
+
+    PitchLog();
+    ~PitchLog();
+
+    // Clears the log. Sealed chunks go to this file from now on; an empty File keeps everything in
+    // memory. The file is overwritten when the first chunk is sealed, and deleted when the log is
+    // cleared, destroyed or given another file.
+    void setSpillFile(const juce::File& file);
+
+    void append(const PitchEvent* events, int numEvents);
+    void clear();
+
+    int size() const { return numEvents.load(std::memory_order_acquire); }
+
+    // Changes on every clear(), so incremental readers know to start over
+    int getGeneration() const { return generation.load(std::memory_order_acquire); }
+
+    // Calls visitor(const PitchEvent* events, int numEvents) for consecutive spans from startIndex
+    // to the end of the log, stopping early if it returns false. The log is locked meanwhile, so
+    // visitors should be quick; the spans are only valid during the call.
+    template <typename Visitor>
+    void visit(int startIndex, Visitor&& visitor) const
+    {
+        RealtimeSafety::CheckedScopedLock lock(logLock);
+        const int total = size();
+
+        for (int index = juce::jmax(0, startIndex); index < total;)
+        {
+            const int offset = index % eventsPerChunk;
+            const int count = juce::jmin(eventsPerChunk - offset, total - index);
+            const PitchEvent* events = getChunk(index / eventsPerChunk);
+
+            if (events == nullptr || !visitor(events + offset, count))
+                return;
+
+            index += count;
+        }
+    }
+
+    // Copies up to maxEvents events from startIndex; returns how many were copied
+    int read(int startIndex, PitchEvent* dest, int maxEvents) const;
+
+private:
+    // Streams sealed chunks to the spill file
+    class SpillThread : public juce::Thread
+    {
+    public:
+        explicit SpillThread(PitchLog& o) : juce::Thread("Pitch log spill"), owner(o) {}
+        void run() override;
+
+    private:
+        PitchLog& owner;
+    };
+
+    PitchEvent* takeFreeChunk();
+    const PitchEvent* getChunk(int chunkIndex) const;
+    bool readSpilledChunk(int chunkIndex) const;
+    void spillSealedChunks();
+    void evictSpilledChunks();
+    void resetChunks();
+    void openSpillFile();
+
+    mutable juce::CriticalSection logLock;   // chunk table, pool and read-back state
+    juce::CriticalSection spillLock;         // held while a chunk is written or the file replaced
+
+    std::vector<PitchEvent*> chunks;         // nullptr once spilled and evicted
+    std::vector<std::unique_ptr<PitchEvent[]>> storage;
+    std::vector<PitchEvent*> freeChunks;
+    std::atomic<int> numEvents{ 0 };
+    std::atomic<int> generation{ 0 };
+
+    juce::File spillFile;
+    std::unique_ptr<juce::FileOutputStream> spillOutput;
+    bool spillFailed = false;                // opening or writing failed; all in memory until clear()
+    int spilledChunks = 0;                   // written to the file, in order
+    int firstResidentChunk = 0;              // chunks before this one have been evicted
+
+    mutable std::unique_ptr<juce::FileInputStream> spillInput;
+    mutable juce::MemoryBlock readBackBytes;
+    mutable std::unique_ptr<PitchEvent[]> readBack;
+    mutable int readBackChunk = -1;
+
+    SpillThread spillThread{ *this };
+
+    JUCE_DECLARE_NON_COPYABLE(PitchLog)
+};
\ No newline at end of file
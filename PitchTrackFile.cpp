@@ -0,0 +1,358 @@
+#include "PitchTrackFile.h"
+
+namespace
+{
+    constexpr juce::uint8 magic[4] = { 'P', 'T', 'R', 'K' };
+
+    constexpr double lowestFrequency = 8.17579891564;   // MIDI note 0
+    constexpr double quarterCentsPerOctave = 4800.0;
+    constexpr float velocityScale = 2.0f;
+
+    // Byte-wise so the format reads the same on any host and from unaligned (mapped) memory
+    juce::uint32 readUint16(const juce::uint8* p) { return static_cast<juce::uint32>(p[0] | (p[1] << 8)); }
+
+    juce::uint32 readUint32(const juce::uint8* p)
+    {
+        return static_cast<juce::uint32>(p[0]) | (static_cast<juce::uint32>(p[1]) << 8)
+             | (static_cast<juce::uint32>(p[2]) << 16) | (static_cast<juce::uint32>(p[3]) << 24);
+    }
+
+    juce::int64 readInt64(const juce::uint8* p)
+    {
+        return static_cast<juce::int64>(readUint32(p) | (static_cast<juce::uint64>(readUint32(p + 4)) << 32));
+    }
+
+    void writeVarint(std::vector<juce::uint8>& dest, juce::int64 value)
+    {
+        // Zigzag, so small negative deltas stay short too
+        auto bits = (static_cast<juce::uint64>(value) << 1) ^ static_cast<juce::uint64>(value >> 63);
+
+        while (bits >= 0x80)
+        {
+            dest.push_back(static_cast<juce::uint8>(bits | 0x80));
+            bits >>= 7;
+        }
+
+        dest.push_back(static_cast<juce::uint8>(bits));
+    }
+
+    // Returns false if the varint runs past end
+    bool readVarint(const juce::uint8*& p, const juce::uint8* end, juce::int64& value)
+    {
+        juce::uint64 bits = 0;
+
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            const juce::uint8 byte = *p++;
+            bits |= static_cast<juce::uint64>(byte & 0x7f) << shift;
+
+            if ((byte & 0x80) == 0)
+            {
+                value = static_cast<juce::int64>(bits >> 1) ^ -static_cast<juce::int64>(bits & 1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Streams assert on a null source, which an empty column has
+    template <typename T>
+    bool writeColumn(juce::OutputStream& output, const std::vector<T>& column)
+    {
+        return column.empty() || output.write(column.data(), column.size() * sizeof(T));
+    }
+
+    juce::uint16 encodeFrequency(float frequency)
+    {
+        if (!(frequency > 0.0f))
+            return 0;
+
+        const double quarterCents = std::round(quarterCentsPerOctave * std::log2(frequency / lowestFrequency));
+        return static_cast<juce::uint16>(juce::jlimit(0.0, 65534.0, quarterCents) + 1.0);
+    }
+
+    float decodeFrequency(juce::uint32 value)
+    {
+        if (value == 0)
+            return 0.0f;
+
+        return static_cast<float>(lowestFrequency * std::exp2((value - 1) / quarterCentsPerOctave));
+    }
+}
+
+bool PitchTrackFormat::isPitchTrack(const void* data, size_t size)
+{
+    return data != nullptr && size >= static_cast<size_t>(version1HeaderSize) && std::memcmp(data, magic, sizeof(magic)) == 0;
+}
+
+//==============================================================================
+void PitchTrackWriter::add(const PitchEvent& event)
+{
+    const auto tick = static_cast<juce::int64>(std::llround(event.timeInSeconds * PitchTrackFormat::ticksPerSecond));
+
+    if (notes.size() % PitchTrackFormat::eventsPerBlock == 0)
+    {
+        index.push_back({ tick, static_cast<juce::uint32>(times.size()) });
+        previousTick = tick;
+    }
+
+    writeVarint(times, tick - previousTick);
+    previousTick = tick;
+
+    frequencies.push_back(event.isRest() ? 0 : encodeFrequency(event.frequency));
+    notes.push_back(static_cast<juce::int8>(juce::jlimit(-1, 127, event.midiNote)));
+    velocities.push_back(static_cast<juce::uint8>(juce::jlimit(0.0f, 254.0f, std::round(event.velocity * velocityScale))));
+    channels.push_back(static_cast<juce::uint8>(juce::jlimit(0, 255, event.channel)));
+}
+
+void PitchTrackWriter::add(const PitchEvent* events, int numEvents)
+{
+    for (int i = 0; i < numEvents; ++i)
+        add(events[i]);
+}
+
+void PitchTrackWriter::clear()
+{
+    index.clear();
+    times.clear();
+    frequencies.clear();
+    notes.clear();
+    velocities.clear();
+    channels.clear();
+    previousTick = 0;
+}
+
+size_t PitchTrackWriter::getTotalSize() const
+{
+    // The time column is padded to keep the frequency column 2-byte aligned
+    return static_cast<size_t>(PitchTrackFormat::headerSize) + index.size() * PitchTrackFormat::indexEntrySize
+         + ((times.size() + 1) & ~static_cast<size_t>(1)) + frequencies.size() * 2 + notes.size() + velocities.size() + channels.size();
+}
+
+bool PitchTrackWriter::writeTo(juce::OutputStream& output) const
+{
+    using namespace PitchTrackFormat;
+
+    const auto numEvents = static_cast<juce::uint32>(notes.size());
+    const auto indexOffset = static_cast<juce::uint32>(headerSize);
+    const auto timeOffset = indexOffset + static_cast<juce::uint32>(index.size() * indexEntrySize);
+    const auto frequencyOffset = timeOffset + static_cast<juce::uint32>((times.size() + 1) & ~static_cast<size_t>(1));
+    const auto noteOffset = frequencyOffset + numEvents * 2;
+    const auto velocityOffset = noteOffset + numEvents;
+    const auto channelOffset = velocityOffset + numEvents;
+    const auto totalSize = channelOffset + numEvents;
+
+    bool ok = output.write(magic, sizeof(magic))
+           && output.writeShort(static_cast<short>(version))
+           && output.writeShort(static_cast<short>(headerSize))
+           && output.writeInt(static_cast<int>(numEvents))
+           && output.writeInt(eventsPerBlock)
+           && output.writeInt(static_cast<int>(index.size()))
+           && output.writeInt(ticksPerSecond);
+
+    for (auto offset : { indexOffset, timeOffset, frequencyOffset, noteOffset, velocityOffset, totalSize, channelOffset })
+        ok = ok && output.writeInt(static_cast<int>(offset));
+
+    for (const auto& entry : index)
+        ok = ok && output.writeInt64(entry.firstTick) && output.writeInt(static_cast<int>(entry.timeOffset)) && output.writeInt(0);
+
+    ok = ok && writeColumn(output, times);
+    if (times.size() % 2 != 0)
+        ok = ok && output.writeByte(0);
+
+    for (auto frequency : frequencies)
+        ok = ok && output.writeShort(static_cast<short>(frequency));
+
+    return ok && writeColumn(output, notes) && writeColumn(output, velocities) && writeColumn(output, channels);
+}
+
+bool PitchTrackWriter::writeTo(const juce::File& file) const
+{
+    file.deleteFile();
+    juce::FileOutputStream output(file);
+
+    if (!output.openedOk() || !writeTo(output))
+        return false;
+
+    output.flush();
+    return !output.getStatus().failed();
+}
+
+//==============================================================================
+bool PitchTrackReader::open(const void* data, size_t size)
+{
+    close();
+
+    if (!PitchTrackFormat::isPitchTrack(data, size))
+        return false;
+
+    const auto* header = static_cast<const juce::uint8*>(data);
+
+    // Newer versions may add to the header, but must keep these fields where they are
+    const auto headerBytes = readUint16(header + 6);
+    const auto events = readUint32(header + 8);
+    const auto eventsPerBlock = readUint32(header + 12);
+    const auto blocks = readUint32(header + 16);
+    const auto ticks = readUint32(header + 20);
+    const auto index = readUint32(header + 24);
+    const auto time = readUint32(header + 28);
+    const auto frequency = readUint32(header + 32);
+    const auto note = readUint32(header + 36);
+    const auto velocity = readUint32(header + 40);
+    const auto total = readUint32(header + 44);
+
+    // Version 1 tracks end at the velocity column
+    const bool hasChannels = readUint16(header + 4) >= 2 && headerBytes >= PitchTrackFormat::headerSize
+                           && size >= static_cast<size_t>(PitchTrackFormat::headerSize);
+    const auto channel = hasChannels ? readUint32(header + 48) : 0;
+
+    if (readUint16(header + 4) < 1 || headerBytes < PitchTrackFormat::version1HeaderSize
+        || events > static_cast<juce::uint32>(std::numeric_limits<int>::max()) || eventsPerBlock == 0 || ticks == 0
+        || blocks != (static_cast<juce::uint64>(events) + eventsPerBlock - 1) / eventsPerBlock
+        || total > size || index < headerBytes
+        || static_cast<juce::uint64>(index) + static_cast<juce::uint64>(blocks) * PitchTrackFormat::indexEntrySize > time
+        || time > frequency
+        || static_cast<juce::uint64>(frequency) + static_cast<juce::uint64>(events) * 2 > note
+        || static_cast<juce::uint64>(note) + events > velocity
+        || static_cast<juce::uint64>(velocity) + events > total
+        || (hasChannels && (static_cast<juce::uint64>(velocity) + events > channel || static_cast<juce::uint64>(channel) + events > total)))
+        return false;
+
+    base = header;
+    totalSize = total;
+    numEvents = static_cast<int>(events);
+    numBlocks = static_cast<int>(blocks);
+    blockSize = static_cast<int>(juce::jmin(eventsPerBlock, static_cast<juce::uint32>(std::numeric_limits<int>::max())));
+    ticksPerSecond = static_cast<double>(ticks);
+    indexOffset = index;
+    timeOffset = time;
+    timeEnd = frequency;
+    frequencyOffset = frequency;
+    noteOffset = note;
+    velocityOffset = velocity;
+    channelOffset = channel;
+    return true;
+}
+
+void PitchTrackReader::close()
+{
+    base = nullptr;
+    totalSize = 0;
+    numEvents = 0;
+    numBlocks = 0;
+}
+
+juce::int64 PitchTrackReader::getBlockTick(int block) const
+{
+    return readInt64(base + indexOffset + static_cast<size_t>(block) * PitchTrackFormat::indexEntrySize);
+}
+
+const juce::uint8* PitchTrackReader::getBlockTimes(int block) const
+{
+    // A corrupt offset lands at the end of the column, where decoding stops
+    const auto offset = readUint32(base + indexOffset + static_cast<size_t>(block) * PitchTrackFormat::indexEntrySize + 8);
+    return base + timeOffset + juce::jmin(offset, timeEnd - timeOffset);
+}
+
+int PitchTrackReader::findEvent(double timeInSeconds) const
+{
+    if (numEvents == 0)
+        return 0;
+
+    // Times were rounded to whole ticks, so allow for that when comparing
+    const auto target = static_cast<juce::int64>(std::ceil(timeInSeconds * ticksPerSecond - 1.0e-6));
+
+    // First block starting at or after the target; the answer is in the block before, or is its first event
+    int low = 0, high = numBlocks;
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        if (getBlockTick(middle) < target)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low == 0)
+        return 0;
+
+    const int block = low - 1;
+    const int first = block * blockSize;
+    const int last = juce::jmin(numEvents, first + blockSize);
+
+    const auto* p = getBlockTimes(block);
+    const auto* end = base + timeEnd;
+    juce::int64 tick = getBlockTick(block);
+
+    for (int i = first; i < last; ++i)
+    {
+        juce::int64 delta = 0;
+        if (!readVarint(p, end, delta))
+            return numEvents;
+
+        tick += delta;
+        if (tick >= target)
+            return i;
+    }
+
+    return last;
+}
+
+int PitchTrackReader::read(int startIndex, PitchEvent* dest, int maxEvents) const
+{
+    if (startIndex < 0 || startIndex >= numEvents || maxEvents <= 0)
+        return 0;
+
+    const int count = juce::jmin(maxEvents, numEvents - startIndex);
+    int block = startIndex / blockSize;
+
+    // Skip the time deltas ahead of startIndex within its block
+    const auto* p = getBlockTimes(block);
+    const auto* end = base + timeEnd;
+    juce::int64 tick = getBlockTick(block);
+    juce::int64 delta = 0;
+
+    for (int i = block * blockSize; i < startIndex; ++i)
+    {
+        if (!readVarint(p, end, delta))
+            return 0;
+
+        tick += delta;
+    }
+
+    for (int n = 0; n < count; ++n)
+    {
+        const int i = startIndex + n;
+
+        // Each block restarts from its index entry
+        if (i % blockSize == 0 && i / blockSize != block)
+        {
+            block = i / blockSize;
+            p = getBlockTimes(block);
+            tick = getBlockTick(block);
+        }
+
+        if (!readVarint(p, end, delta))
+            return n;
+
+        tick += delta;
+
+        auto& event = dest[n];
+        event.timeInSeconds = static_cast<double>(tick) / ticksPerSecond;
+        event.frequency = decodeFrequency(readUint16(base + frequencyOffset + static_cast<size_t>(i) * 2));
+        event.midiNote = static_cast<juce::int8>(base[noteOffset + static_cast<size_t>(i)]);
+        event.velocity = base[velocityOffset + static_cast<size_t>(i)] / velocityScale;
+        event.channel = channelOffset != 0 ? base[channelOffset + static_cast<size_t>(i)] : 0;
+    }
+
+    return count;
+}
+
+//==============================================================================
+PitchTrackFile::PitchTrackFile(const juce::File& file)
+    : mappedFile(std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly))
+{
+    if (mappedFile->getData() == nullptr || !reader.open(mappedFile->getData(), mappedFile->getSize()))
+        mappedFile.reset();
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "PitchTracker.h"
+#include <cmath>
+
+namespace
+{
+    constexpr float voicingSwitchProbability = 0.01f;
+    constexpr float jumpProbability = 0.01f;         // share of transitions that may go anywhere
+    constexpr float noCandidateProbability = 1.0e-6f;
+}
+
+void PitchTracker::prepare(float newMinFrequency, float maxFrequency)
+{
+    minFrequency = newMinFrequency;
+    numBins = juce::jmax(1, static_cast<int>(std::ceil(12.0f * binsPerSemitone * std::log2(maxFrequency / minFrequency))) + 1);
+
+    // Triangular local moves, the rest spread evenly over every bin
+    logStep.resize(2 * maxStep + 1);
+    float total = 0.0f;
+    for (int k = -maxStep; k <= maxStep; ++k)
+        total += static_cast<float>(maxStep + 1 - std::abs(k));
+
+    for (int k = -maxStep; k <= maxStep; ++k)
+        logStep[k + maxStep] = std::log((1.0f - jumpProbability) * (maxStep + 1 - std::abs(k)) / total);
+
+    thresholdWeights.resize(numThresholds);
+    float weightTotal = 0.0f;
+    for (int i = 0; i < numThresholds; ++i)
+    {
+        const float x = (i + 1) / static_cast<float>(numThresholds);
+        thresholdWeights[i] = x * std::pow(1.0f - x, 10.33f);
+        weightTotal += thresholdWeights[i];
+    }
+
+    for (auto& w : thresholdWeights)
+        w /= weightTotal;
+
+    voiced.assign(numBins, 0.0f);
+    unvoiced.assign(numBins, 0.0f);
+    nextVoiced.assign(numBins, 0.0f);
+    nextUnvoiced.assign(numBins, 0.0f);
+    voicedObservation.assign(numBins, 0.0f);
+    binFrequency.assign(numBins, 0.0f);
+
+    reset();
+}
+
+void PitchTracker::reset()
+{
+    std::fill(voiced.begin(), voiced.end(), 0.0f);
+    std::fill(unvoiced.begin(), unvoiced.end(), 0.0f);
+    lastFrequency = 0.0f;
+}
+
+int PitchTracker::binFor(float frequency) const
+{
+    if (frequency <= 0.0f)
+        return -1;
+
+    const int bin = juce::roundToInt(12.0f * binsPerSemitone * std::log2(frequency / minFrequency));
+    return juce::isPositiveAndBelow(bin, numBins) ? bin : -1;
+}
+
+void PitchTracker::addCandidates(const float* curve, int lo, int hi, double sampleRate, Observation& observation) const
+{
+    // Only running record lows (in lag order) can ever be the first dip below some threshold.
+    // Until finishObservation() runs, probability holds the dip's curve value.
+    int lastTau = -1;
+
+    for (int tau = lo + 1; tau < hi; ++tau)
+    {
+        if (!(curve[tau] < curve[tau - 1] && curve[tau] <= curve[tau + 1]))
+            continue;
+
+        const int n = observation.numCandidates;
+        if (n > 0 && curve[tau] >= observation.candidates[n - 1].probability)
+            continue;
+
+        // Noise splits one valley into several dips; within about a semitone, keep only the deepest
+        if (n > 0 && lastTau >= 0 && tau - lastTau < juce::jmax(2, lastTau / 16))
+            --observation.numCandidates;
+        else if (n == maxCandidates)
+        {
+            // Full: the earliest, shallowest dip matters least
+            std::copy(observation.candidates + 1, observation.candidates + maxCandidates, observation.candidates);
+            --observation.numCandidates;
+        }
+
+        lastTau = tau;
+
+        float refinedTau = static_cast<float>(tau);
+        const float denom = curve[tau - 1] - 2.0f * curve[tau] + curve[tau + 1];
+        if (std::abs(denom) > 0.0001f)
+            refinedTau += juce::jlimit(-1.0f, 1.0f, 0.5f * (curve[tau - 1] - curve[tau + 1]) / denom);
+
+        auto& candidate = observation.candidates[observation.numCandidates++];
+        candidate.frequency = static_cast<float>(sampleRate / refinedTau);
+        candidate.probability = curve[tau];
+    }
+}
+
+void PitchTracker::finishObservation(Observation& observation) const
+{
+    float values[maxCandidates];
+    for (int i = 0; i < observation.numCandidates; ++i)
+    {
+        values[i] = observation.candidates[i].probability;
+        observation.candidates[i].probability = 0.0f;
+    }
+
+    if (observation.numCandidates == 0)
+        return;
+
+    // Candidates are record lows, so the first one below a threshold is the first index that passes.
+    // Thresholds no dip passes go to the lowest one, like YIN's own fallback: voicing is left to the
+    // RMS gate, as in the untracked detector, rather than pYIN's much smaller absolute-minimum prior.
+    for (int t = 0; t < numThresholds; ++t)
+    {
+        const float threshold = (t + 1) / static_cast<float>(numThresholds);
+        int chosen = 0;
+        while (chosen < observation.numCandidates && values[chosen] >= threshold)
+            ++chosen;
+
+        if (chosen < observation.numCandidates)
+            observation.candidates[chosen].probability += thresholdWeights[t];
+        else
+            observation.candidates[observation.numCandidates - 1].probability += thresholdWeights[t];
+    }
+}
+
+float PitchTracker::process(const Observation& observation)
+{
+    std::fill(voicedObservation.begin(), voicedObservation.end(), noCandidateProbability / numBins);
+    std::fill(binFrequency.begin(), binFrequency.end(), 0.0f);
+
+    float voicedProbability = 0.0f;
+    for (int i = 0; i < observation.numCandidates; ++i)
+    {
+        const auto& candidate = observation.candidates[i];
+        const int bin = binFor(candidate.frequency);
+
+        if (bin < 0 || candidate.probability <= 0.0f)
+            continue;
+
+        // The bin reports the frequency of its most likely candidate
+        if (candidate.probability > voicedObservation[bin])
+            binFrequency[bin] = candidate.frequency;
+
+        voicedObservation[bin] += candidate.probability;
+        voicedProbability += candidate.probability;
+    }
+
+    const float logUnvoicedObservation = std::log(juce::jmax(1.0f - voicedProbability, noCandidateProbability) / numBins);
+    const float logStay = std::log(1.0f - voicingSwitchProbability);
+    const float logSwitch = std::log(voicingSwitchProbability);
+    const float logFar = std::log(jumpProbability / numBins);
+
+    const float maxVoiced = *std::max_element(voiced.begin(), voiced.end());
+    const float maxUnvoiced = *std::max_element(unvoiced.begin(), unvoiced.end());
+
+    float best = -std::numeric_limits<float>::max();
+    int bestBin = 0;
+    bool bestIsVoiced = false;
+
+    for (int b = 0; b < numBins; ++b)
+    {
+        float fromVoiced = maxVoiced + logFar;
+        float fromUnvoiced = maxUnvoiced + logFar;
+
+        const int lo = juce::jmax(0, b - maxStep);
+        const int hi = juce::jmin(numBins - 1, b + maxStep);
+        for (int source = lo; source <= hi; ++source)
+        {
+            const float step = logStep[b - source + maxStep];
+            fromVoiced = juce::jmax(fromVoiced, voiced[source] + step);
+            fromUnvoiced = juce::jmax(fromUnvoiced, unvoiced[source] + step);
+        }
+
+        nextVoiced[b] = juce::jmax(fromVoiced + logStay, fromUnvoiced + logSwitch) + std::log(voicedObservation[b]);
+        nextUnvoiced[b] = juce::jmax(fromUnvoiced + logStay, fromVoiced + logSwitch) + logUnvoicedObservation;
+
+        if (nextVoiced[b] > best)   { best = nextVoiced[b];   bestBin = b; bestIsVoiced = true; }
+        if (nextUnvoiced[b] > best) { best = nextUnvoiced[b]; bestBin = b; bestIsVoiced = false; }
+    }
+
+    // Keep the scores near zero so they never run out of float range
+    for (int b = 0; b < numBins; ++b)
+    {
+        voiced[b] = nextVoiced[b] - best;
+        unvoiced[b] = nextUnvoiced[b] - best;
+    }
+
+    if (!bestIsVoiced)
+        lastFrequency = 0.0f;
+    else if (binFrequency[bestBin] > 0.0f)
+        lastFrequency = binFrequency[bestBin];
+    else
+        lastFrequency = minFrequency * std::pow(2.0f, bestBin / (12.0f * binsPerSemitone));
+
+    return lastFrequency;
+}
\ No newline at end of file
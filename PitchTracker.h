@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Frame-to-frame pitch smoothing with a hidden Markov model (pYIN-style)
+//
+// Each frame's difference curve is turned into a handful of period candidates with probabilities:
+// for every threshold in a beta-distributed set, the first dip below it gets that threshold's
+// weight (or the lowest dip when none is below it), so a deep early dip collects most of the mass
+// and an octave-down dip only a little.
+// The hidden states are pitch bins (a fifth of a semitone apart) in a voiced and an unvoiced copy.
+// Pitch may drift a couple of semitones per frame cheaply, while larger jumps pay a fixed penalty,
+// so a single frame that prefers the octave is outvoted by the frames around it.
+// Decoding is causal (max-product forward pass, best state of the newest frame), so smoothing
+// adds no latency; the path is never revised in hindsight. Nothing allocates after prepare().
+class PitchTracker
+{
+public:
+    static constexpr int maxCandidates = 8;
+
+    struct Candidate
+    {
+        float frequency = 0.0f;
+        float probability = 0.0f;
+    };
+
+    // Period candidates for one frame; their probabilities sum to the frame's voicing probability
+    struct Observation
+    {
+        Candidate candidates[maxCandidates];
+        int numCandidates = 0;
+    };
+
+    void prepare(float minFrequency, float maxFrequency);
+    void reset();
+
+    // curve[lo..hi] is a YIN-style difference curve (0 = periodic). Appends its dips, in lag order,
+    // to the observation. Lags outside the ranges passed in across calls must not be touched, so
+    // several narrow windows can be scanned one after another.
+    void addCandidates(const float* curve, int lo, int hi, double sampleRate, Observation& observation) const;
+
+    // Converts the dips collected by addCandidates() into probabilities
+    void finishObservation(Observation& observation) const;
+
+    // Advances the model by one frame and returns the smoothed frequency, 0 when unvoiced
+    float process(const Observation& observation);
+
+    bool isVoiced() const { return lastFrequency > 0.0f; }
+
+private:
+    int binFor(float frequency) const;
+
+    static constexpr int binsPerSemitone = 5;
+    static constexpr int maxStep = 2 * binsPerSemitone;  // bins reachable at the local transition cost
+    static constexpr int numThresholds = 100;
+
+    float minFrequency = 70.0f;
+    int numBins = 0;
+
+    std::vector<float> logStep;          // 2 * maxStep + 1 entries, index maxStep = no change
+    std::vector<float> thresholdWeights; // beta(2, 11.3) over 0.01 .. 1.00, mean 0.15 like YIN's threshold
+
+    std::vector<float> voiced, unvoiced;              // log scores of the newest frame
+    std::vector<float> nextVoiced, nextUnvoiced;
+    std::vector<float> voicedObservation;
+    std::vector<float> binFrequency;                  // refined candidate frequency seen in each bin this frame
+
+    float lastFrequency = 0.0f;
+};
\ No newline at end of file
@@ -2,8 +2,11 @@
 #include "PluginEditor.h"
 
 PitchDetectorAudioProcessorEditor::PitchDetectorAudioProcessorEditor(PitchDetectorAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), pitchGraph(p)
 {
+    // Added first so it stays behind the controls it overlaps
+    addAndMakeVisible(pitchGraph);
+
     setSize(600, 550);
 
     // Note Label
@@ -55,24 +58,63 @@ PitchDetectorAudioProcessorEditor::PitchDetectorAudioProcessorEditor(PitchDetect
     updateRateLabel.setJustificationType(juce::Justification::centred);
     updateRateLabel.attachToComponent(&updateRateCombo, false);
 
+    // Detector Combo
+    addAndMakeVisible(detectorCombo);
+    detectorCombo.addItem("YIN", 1);
+    detectorCombo.addItem("McLeod (MPM)", 2);
+    detectorCombo.addItem("SWIPE", 3);
+    detectorCombo.addItem("Perceptual", 4);
+    detectorAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        audioProcessor.getParameters(), "detector", detectorCombo);
+
+    addAndMakeVisible(detectorLabel);
+    detectorLabel.setText("Detector", juce::dontSendNotification);
+    detectorLabel.setJustificationType(juce::Justification::centred);
+    detectorLabel.attachToComponent(&detectorCombo, false);
+
+    // Multi-resolution toggle
+    addAndMakeVisible(multiResolutionToggle);
+    multiResolutionToggle.setButtonText("Multi-Res");
+    multiResolutionAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.getParameters(), "multiResolution", multiResolutionToggle);
+
+    // Tuning: reference pitch, temperament and a Scala file for the third one
+    addAndMakeVisible(tuningLabel);
+    tuningLabel.setText("Tuning", juce::dontSendNotification);
+    tuningLabel.setJustificationType(juce::Justification::centred);
+
+    addAndMakeVisible(referencePitchSlider);
+    referencePitchSlider.setSliderStyle(juce::Slider::LinearBar);
+    referencePitchSlider.setTextValueSuffix(" Hz");
+    referencePitchAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.getParameters(), "referencePitch", referencePitchSlider);
+
+    addAndMakeVisible(temperamentCombo);
+    temperamentCombo.addItem("Equal", 1);
+    temperamentCombo.addItem("Just Intonation", 2);
+    temperamentCombo.addItem("Scala File", 3);
+    updateScalaItem();
+    temperamentAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        audioProcessor.getParameters(), "temperament", temperamentCombo);
+
+    addAndMakeVisible(loadScalaButton);
+    loadScalaButton.setButtonText("Load .scl");
+    loadScalaButton.onClick = [this]()
+        {
+            loadScala();
+        };
+
     // Recording controls
     addAndMakeVisible(recordButton);
-    recordButton.setButtonText("Record");
-    recordButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red.darker());
+    updateRecordButton();
     recordButton.onClick = [this]()
         {
             if (audioProcessor.isRecording())
-            {
                 audioProcessor.stopRecording();
-                recordButton.setButtonText("Record");
-                recordButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red.darker());
-            }
             else
-            {
                 audioProcessor.startRecording();
-                recordButton.setButtonText("Stop");
-                recordButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green.darker());
-            }
+
+            updateRecordButton();
         };
 
     addAndMakeVisible(clearButton);
@@ -86,11 +128,118 @@ PitchDetectorAudioProcessorEditor::PitchDetectorAudioProcessorEditor(PitchDetect
     recordingStatusLabel.setJustificationType(juce::Justification::centred);
     recordingStatusLabel.setColour(juce::Label::textColourId, juce::Colours::white);
 
+    // Polyphonic toggle
+    addAndMakeVisible(polyphonicToggle);
+    polyphonicToggle.setButtonText("Poly");
+    polyphonicAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.getParameters(), "polyphonic", polyphonicToggle);
+
+    // Live MIDI output
+    addAndMakeVisible(midiOutputToggle);
+    midiOutputToggle.setButtonText("MIDI Out");
+    midiOutputAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.getParameters(), "midiOutput", midiOutputToggle);
+
+    // MIDI export
+    addAndMakeVisible(exportButton);
+    exportButton.setButtonText("Export MIDI");
+    exportButton.onClick = [this]()
+        {
+            exportMidi();
+        };
+
+    addAndMakeVisible(pitchBendToggle);
+    pitchBendToggle.setButtonText("Pitch Bend");
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    addAndMakeVisible(diagnosticsButton);
+    diagnosticsButton.setButtonText("Diagnostics");
+    diagnosticsButton.setClickingTogglesState(true);
+    diagnosticsButton.onClick = [this]()
+        {
+            diagnosticsOverlay.setVisible(diagnosticsButton.getToggleState());
+            diagnosticsOverlay.update();
+        };
+
+    // Added last so it covers the graph
+    addChildComponent(diagnosticsOverlay);
+   #endif
+
+    audioProcessor.setEditorOpen(true);
     startTimerHz(30);
 }
 
 PitchDetectorAudioProcessorEditor::~PitchDetectorAudioProcessorEditor()
 {
+    audioProcessor.setEditorOpen(false);
+}
+
+void PitchDetectorAudioProcessorEditor::exportMidi()
+{
+    exportChooser = std::make_unique<juce::FileChooser>("Export pitch log as MIDI",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("PitchLog.mid"), "*.mid");
+
+    const int flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                    | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    exportChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            MidiFileExporter::Settings settings;
+            settings.bpm = 0.0; // host tempo if known
+            settings.includePitchBend = pitchBendToggle.getToggleState();
+
+            if (!audioProcessor.exportMidiFile(file.withFileExtension(".mid"), settings))
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Export MIDI",
+                    "Could not write " + file.getFullPathName());
+        });
+}
+
+void PitchDetectorAudioProcessorEditor::loadScala()
+{
+    scalaChooser = std::make_unique<juce::FileChooser>("Load Scala scale",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory), "*.scl");
+
+    scalaChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+        [this](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            juce::String error;
+            if (audioProcessor.loadScalaFile(file, error))
+                updateScalaItem();
+            else
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Load Scala scale",
+                    file.getFileName() + ": " + error);
+        });
+}
+
+void PitchDetectorAudioProcessorEditor::updateRecordButton()
+{
+    const bool recording = audioProcessor.isRecording();
+    recordButton.setButtonText(recording ? "Stop" : "Record");
+    recordButton.setColour(juce::TextButton::buttonColourId, recording ? juce::Colours::green.darker() : juce::Colours::red.darker());
+}
+
+void PitchDetectorAudioProcessorEditor::updateScalaItem()
+{
+    const auto description = audioProcessor.getScalaDescription();
+    if (description == shownScalaDescription)
+        return;
+
+    temperamentCombo.changeItemText(3, description.isNotEmpty() ? description : juce::String("Scala File"));
+    shownScalaDescription = description;
+}
+
+juce::String PitchDetectorAudioProcessorEditor::noteNameOf(float frequency) const
+{
+    const int midiNote = audioProcessor.getTuning().lookup(frequency).midiNote;
+    return midiNote >= 0 ? juce::String(Tuning::sharpNames[static_cast<size_t>(midiNote)].text) : juce::String("--");
 }
 
 void PitchDetectorAudioProcessorEditor::paint(juce::Graphics& g)
@@ -146,78 +295,20 @@ void PitchDetectorAudioProcessorEditor::paint(juce::Graphics& g)
         g.drawText("+50", centerX + barWidth / 2 + 5, indicatorY - 6, 20, 12, juce::Justification::left);
     }
 
-    // Draw pitch graph
-    auto graphBounds = juce::Rectangle<int>(10, 350, getWidth() - 20, 150);
-    drawPitchGraph(g, graphBounds);
-}
-
-void PitchDetectorAudioProcessorEditor::drawPitchGraph(juce::Graphics& g, juce::Rectangle<int> bounds)
-{
-    // Background
-    g.setColour(juce::Colour(0xff0a0a0a));
-    g.fillRect(bounds);
-
-    g.setColour(juce::Colours::grey);
-    g.drawRect(bounds, 1);
-
-    // Get pitch log
-    auto pitchLog = audioProcessor.getPitchLog();
-
-    if (pitchLog.empty())
-    {
-        g.setColour(juce::Colours::grey);
-        g.setFont(14.0f);
-        g.drawText("Press Record to log pitch data", bounds, juce::Justification::centred);
-        return;
-    }
-
-    // Draw grid lines (MIDI notes)
-    g.setColour(juce::Colour(0xff2a2a2a));
-    for (int note = 0; note <= 127; note += 12)
-    {
-        float y = bounds.getY() + bounds.getHeight() * (1.0f - note / 127.0f);
-        g.drawLine(bounds.getX(), y, bounds.getRight(), y, 1.0f);
-    }
-
-    // Find time range
-    double maxTime = 0.0;
-    for (const auto& event : pitchLog)
-        maxTime = juce::jmax(maxTime, event.timeInSeconds);
-
-    if (maxTime < 0.1)
-        maxTime = 1.0;
-
-    // Draw pitch curve
-    juce::Path pitchPath;
-    bool firstPoint = true;
-
-    for (const auto& event : pitchLog)
+    // Other channels' tracks, when the input has more than one
+    const int numChannels = audioProcessor.getNumAnalysedChannels();
+    if (numChannels > 1)
     {
-        float x = bounds.getX() + (event.timeInSeconds / maxTime) * bounds.getWidth();
-        float y = bounds.getY() + bounds.getHeight() * (1.0f - event.midiNote / 127.0f);
-
-        if (firstPoint)
+        juce::String channelText;
+        for (int c = 0; c < numChannels; ++c)
         {
-            pitchPath.startNewSubPath(x, y);
-            firstPoint = false;
+            channelText << "Ch" << (c + 1) << " " << noteNameOf(audioProcessor.getChannelFrequency(c)) << "  ";
         }
-        else
-        {
-            pitchPath.lineTo(x, y);
-        }
-    }
-
-    g.setColour(juce::Colours::cyan);
-    g.strokePath(pitchPath, juce::PathStrokeType(2.0f));
 
-    // Draw time markers
-    g.setColour(juce::Colours::lightgrey);
-    g.setFont(10.0f);
-    g.drawText("0s", bounds.getX(), bounds.getBottom() + 2, 30, 12, juce::Justification::left);
-    g.drawText(juce::String(maxTime, 1) + "s", bounds.getRight() - 30, bounds.getBottom() + 2, 30, 12, juce::Justification::right);
-
-    // Draw note count
-    g.drawText(juce::String(pitchLog.size()) + " events", bounds.getX(), bounds.getY() - 15, 100, 12, juce::Justification::left);
+        g.setColour(juce::Colours::lightgrey);
+        g.setFont(11.0f);
+        g.drawFittedText(channelText.trimEnd(), 10, 240, getWidth() - 20, 14, juce::Justification::centred, 1);
+    }
 }
 
 void PitchDetectorAudioProcessorEditor::resized()
@@ -228,10 +319,23 @@ void PitchDetectorAudioProcessorEditor::resized()
 
     // Top section - pitch display
     auto topSection = bounds.removeFromTop(220);
-    noteLabel.setBounds(topSection.removeFromTop(80));
-    frequencyLabel.setBounds(topSection.removeFromTop(30));
+
+    // Tuning controls in the top right corner, with the same width kept clear on the left so the
+    // note stays centred
+    auto displayRows = topSection.removeFromTop(110);
+    auto tuningColumn = displayRows.removeFromRight(110);
+    displayRows.removeFromLeft(110);
+    noteLabel.setBounds(displayRows.removeFromTop(80));
+    frequencyLabel.setBounds(displayRows);
     centsLabel.setBounds(topSection.removeFromTop(30));
 
+    tuningLabel.setBounds(tuningColumn.removeFromTop(20));
+    referencePitchSlider.setBounds(tuningColumn.removeFromTop(24));
+    tuningColumn.removeFromTop(5);
+    temperamentCombo.setBounds(tuningColumn.removeFromTop(24));
+    tuningColumn.removeFromTop(5);
+    loadScalaButton.setBounds(tuningColumn.removeFromTop(24));
+
     bounds.removeFromTop(10); // Spacing
 
     // Controls section
@@ -244,19 +348,41 @@ void PitchDetectorAudioProcessorEditor::resized()
 
     auto rightControls = controlsSection;
     rightControls.removeFromLeft(10);
-    updateRateLabel.setBounds(rightControls.removeFromTop(20));
-    updateRateCombo.setBounds(rightControls.removeFromTop(25));
+    auto comboLabels = rightControls.removeFromTop(20);
+    auto comboRow = rightControls.removeFromTop(25);
+    updateRateLabel.setBounds(comboLabels.removeFromLeft(comboLabels.getWidth() / 2 - 5));
+    updateRateCombo.setBounds(comboRow.removeFromLeft(comboRow.getWidth() / 2 - 5));
+    comboLabels.removeFromLeft(10);
+    comboRow.removeFromLeft(10);
+    detectorLabel.setBounds(comboLabels);
+    detectorCombo.setBounds(comboRow);
 
     rightControls.removeFromTop(5);
     auto recordRow = rightControls.removeFromTop(30);
     recordButton.setBounds(recordRow.removeFromLeft(80));
     recordRow.removeFromLeft(10);
     clearButton.setBounds(recordRow.removeFromLeft(80));
-
-    // Status label
-    recordingStatusLabel.setBounds(bounds.removeFromTop(20));
-
-    // Graph takes remaining space (handled in paint)
+    recordRow.removeFromLeft(10);
+    multiResolutionToggle.setBounds(recordRow.removeFromLeft(90));
+
+    // Status row: label plus MIDI controls
+    auto statusRow = bounds.removeFromTop(20);
+    exportButton.setBounds(statusRow.removeFromRight(100));
+    statusRow.removeFromRight(10);
+    pitchBendToggle.setBounds(statusRow.removeFromRight(90));
+    statusRow.removeFromRight(10);
+    midiOutputToggle.setBounds(statusRow.removeFromRight(90));
+    statusRow.removeFromRight(10);
+    polyphonicToggle.setBounds(statusRow.removeFromRight(70));
+    recordingStatusLabel.setBounds(statusRow);
+
+    // Graph, with its labels above and below
+    pitchGraph.setBounds(10, 335, getWidth() - 20, 179);
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    diagnosticsButton.setBounds(getWidth() - 95, 5, 85, 20);
+    diagnosticsOverlay.setBounds(pitchGraph.getBounds());
+   #endif
 }
 
 void PitchDetectorAudioProcessorEditor::timerCallback()
@@ -265,11 +391,40 @@ void PitchDetectorAudioProcessorEditor::timerCallback()
     juce::String note = audioProcessor.getNoteName();
     float cents = audioProcessor.getCentsOffset();
 
+    // In polyphonic mode show every voice, strongest first
+    const auto voices = audioProcessor.getCurrentVoices();
+    if (voices.numVoices > 1)
+    {
+        juce::StringArray names;
+        for (int v = 0; v < voices.numVoices; ++v)
+            names.add(noteNameOf(voices.frequency[v]));
+
+        note = names.joinIntoString(" ");
+    }
+
     noteLabel.setText(note, juce::dontSendNotification);
 
+    // The tuning indicator and channel line only change with the detected pitch
+    const int numChannels = audioProcessor.getNumAnalysedChannels();
+    bool indicatorChanged = frequency != shownFrequency || cents != shownCents || numChannels != shownNumChannels;
+    for (int c = 0; c < numChannels; ++c)
+    {
+        const float channelFrequency = audioProcessor.getChannelFrequency(c);
+        indicatorChanged = indicatorChanged || channelFrequency != shownChannelFrequencies[static_cast<size_t>(c)];
+        shownChannelFrequencies[static_cast<size_t>(c)] = channelFrequency;
+    }
+
+    if (indicatorChanged)
+        repaint(0, 170, getWidth(), 90);
+
+    shownFrequency = frequency;
+    shownCents = cents;
+    shownNumChannels = numChannels;
+
     if (frequency > 0.0f)
     {
-        frequencyLabel.setText(juce::String(frequency, 2) + " Hz", juce::dontSendNotification);
+        const int confidence = juce::roundToInt(audioProcessor.getDetectedConfidence() * 100.0f);
+        frequencyLabel.setText(juce::String(frequency, 2) + " Hz  (" + juce::String(confidence) + "%)", juce::dontSendNotification);
 
         juce::String centsText;
         if (cents > 0)
@@ -286,6 +441,11 @@ void PitchDetectorAudioProcessorEditor::timerCallback()
     }
 
     // Update recording status
+    if (recordButton.getButtonText() != (audioProcessor.isRecording() ? "Stop" : "Record"))
+        updateRecordButton();
+
+    updateScalaItem();
+
     if (audioProcessor.isRecording())
     {
         int logSize = audioProcessor.getLogSize();
@@ -304,5 +464,11 @@ void PitchDetectorAudioProcessorEditor::timerCallback()
         recordingStatusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
     }
 
-    repaint();
+    // Reads only the new log entries and repaints only what they changed
+    pitchGraph.update();
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    if (diagnosticsOverlay.isVisible())
+        diagnosticsOverlay.update();
+   #endif
 }
\ No newline at end of file
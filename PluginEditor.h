@@ -2,6 +2,8 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "PitchGraph.h"
+#include "DiagnosticsOverlay.h"
 
 class PitchDetectorAudioProcessorEditor : public juce::AudioProcessorEditor,
     private juce::Timer
@@ -15,10 +17,26 @@ public:
 
 private:
     void timerCallback() override;
-    void drawPitchGraph(juce::Graphics& g, juce::Rectangle<int> bounds);
+    void exportMidi();
+    void loadScala();
+
+    // Follows the processor, which can also stop recording or change scale when state is restored
+    void updateRecordButton();
+    void updateScalaItem();
+
+    // Sharp name of the nearest note in the current tuning, or "--"
+    juce::String noteNameOf(float frequency) const;
 
     PitchDetectorAudioProcessor& audioProcessor;
 
+    PitchGraph pitchGraph;
+
+    // What the tuning indicator and channel line were last painted with
+    float shownFrequency = -1.0f;
+    float shownCents = 0.0f;
+    int shownNumChannels = 0;
+    std::array<float, PitchDetectionEngine::maxChannels> shownChannelFrequencies{};
+
     juce::Label noteLabel;
     juce::Label frequencyLabel;
     juce::Label centsLabel;
@@ -32,10 +50,47 @@ private:
     juce::Label updateRateLabel;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> updateRateAttachment;
 
+    juce::ComboBox detectorCombo;
+    juce::Label detectorLabel;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> detectorAttachment;
+
+    juce::ToggleButton multiResolutionToggle;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> multiResolutionAttachment;
+
+    // Tuning
+    juce::Label tuningLabel;
+    juce::Slider referencePitchSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> referencePitchAttachment;
+
+    juce::ComboBox temperamentCombo;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> temperamentAttachment;
+
+    juce::TextButton loadScalaButton;
+    juce::String shownScalaDescription;
+    std::unique_ptr<juce::FileChooser> scalaChooser;
+
     // Recording controls
     juce::TextButton recordButton;
     juce::TextButton clearButton;
     juce::Label recordingStatusLabel;
 
+    juce::ToggleButton polyphonicToggle;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> polyphonicAttachment;
+
+    // Live MIDI output
+    juce::ToggleButton midiOutputToggle;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> midiOutputAttachment;
+
+    // MIDI export
+    juce::TextButton exportButton;
+    juce::ToggleButton pitchBendToggle;
+    std::unique_ptr<juce::FileChooser> exportChooser;
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    // Stage timings over the graph, toggled from the title bar
+    juce::TextButton diagnosticsButton;
+    DiagnosticsOverlay diagnosticsOverlay{ audioProcessor };
+   #endif
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchDetectorAudioProcessorEditor)
 };
\ No newline at end of file
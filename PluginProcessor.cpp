@@ -1,6 +1,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include <cmath>
+#include <cstdio>
 
 PitchDetectorAudioProcessor::PitchDetectorAudioProcessor()
     : AudioProcessor(BusesProperties()
@@ -10,30 +11,70 @@ PitchDetectorAudioProcessor::PitchDetectorAudioProcessor()
         {
             std::make_unique<juce::AudioParameterInt>("bufferSize", "Buffer Size", 2048, 16384, 4096),
             std::make_unique<juce::AudioParameterChoice>("updateRate", "Update Rate",
-                juce::StringArray{"2x/sec", "4x/sec", "8x/sec", "12x/sec", "20x/sec", "30x/sec"}, 2)
+                juce::StringArray{"2x/sec", "4x/sec", "8x/sec", "12x/sec", "20x/sec", "30x/sec"}, 2),
+            std::make_unique<juce::AudioParameterBool>("multiResolution", "Multi-Resolution", false),
+            std::make_unique<juce::AudioParameterBool>("midiOutput", "MIDI Output", false),
+            std::make_unique<juce::AudioParameterBool>("polyphonic", "Polyphonic", false),
+            std::make_unique<juce::AudioParameterBool>("adaptiveScheduling", "Adaptive Scheduling", true),
+            std::make_unique<juce::AudioParameterBool>("pitchTracking", "Pitch Tracking", false),
+            std::make_unique<juce::AudioParameterChoice>("detector", "Detector",
+                juce::StringArray{"YIN", "McLeod (MPM)", "SWIPE", "Perceptual"}, 0),
+            std::make_unique<juce::AudioParameterFloat>("referencePitch", "Reference Pitch (A4)",
+                juce::NormalisableRange<float>(415.0f, 466.0f, 0.1f), 440.0f),
+            std::make_unique<juce::AudioParameterChoice>("temperament", "Temperament",
+                juce::StringArray{"Equal", "Just Intonation", "Scala File"}, 0)
         })
 {
     bufferSizeParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("bufferSize"));
     updateRateParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("updateRate"));
+    multiResolutionParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("multiResolution"));
+    midiOutputParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("midiOutput"));
+    polyphonicParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("polyphonic"));
+    adaptiveSchedulingParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("adaptiveScheduling"));
+    pitchTrackingParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("pitchTracking"));
+    detectorParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("detector"));
+    referencePitchParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("referencePitch"));
+    temperamentParam = dynamic_cast<std::atomic<float>*>(parameters.getRawParameterValue("temperament"));
 
     // Initialize buffers
-    int initialSize = 4096;
-    analysisBuffer.resize(initialSize, 0.0f);
-    processingBuffer.resize(initialSize, 0.0f);
-    hannWindow.resize(initialSize);
-
-    // Pre-calculate Hann window
-    for (int i = 0; i < initialSize; ++i)
-    {
-        hannWindow[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (initialSize - 1)));
-    }
+    const int initialSize = 4096;
+    engine.prepare(currentSampleRate.load(), initialSize, static_cast<int>(currentSampleRate.load() / 8));
+    engine.setTaskRunner(&parallelRunner);
+    pitchEventQueue.resize(pitchEventQueueSize);
+    liveMidiQueue.resize(liveMidiQueueSize);
+    pitchLog.setSpillFile(juce::File::getSpecialLocation(juce::File::tempDirectory)
+                              .getNonexistentChildFile("PitchDetectorLog", ".plog", false));
+
+    for (auto& slot : analysisSlots)
+        engine.prepareSnapshot(slot);
+
+    publishNoteName("---");
+    startTimerHz(20);
+
+   #if JUCE_DEBUG
+    // Vector kernels must agree with their scalar references on this CPU
+    jassert(SimdKernels::runSelfTest());
+   #endif
 }
 
-PitchDetectorAudioProcessor::~PitchDetectorAudioProcessor() = default;
+PitchDetectorAudioProcessor::~PitchDetectorAudioProcessor()
+{
+    stopTimer();
+    analysisRegistration.pause();
+}
 
 const juce::String PitchDetectorAudioProcessor::getName() const { return JucePlugin_Name; }
 bool PitchDetectorAudioProcessor::acceptsMidi() const { return false; }
-bool PitchDetectorAudioProcessor::producesMidi() const { return false; }
+bool PitchDetectorAudioProcessor::producesMidi() const
+{
+    // Live MIDI output needs NEEDS_MIDI_OUTPUT on the plugin target (CMakeLists.txt)
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
 bool PitchDetectorAudioProcessor::isMidiEffect() const { return false; }
 double PitchDetectorAudioProcessor::getTailLengthSeconds() const { return 0.0; }
 int PitchDetectorAudioProcessor::getNumPrograms() { return 1; }
@@ -44,358 +85,593 @@ void PitchDetectorAudioProcessor::changeProgramName(int index, const juce::Strin
 
 juce::String PitchDetectorAudioProcessor::getNoteName() const
 {
-    juce::ScopedLock lock(noteNameLock);
-    return noteName;
+    return juce::String(noteDisplay.load().name);
+}
+
+void PitchDetectorAudioProcessor::publishNoteName(const char* name)
+{
+    NoteDisplay display{};
+    std::snprintf(display.name, sizeof(display.name), "%s", name);
+    noteDisplay.store(display);
 }
 
 void PitchDetectorAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    // Buffers below are shared with the analysis side, so park it while they are resized
+    analysisRegistration.pause();
+
     // Store the actual sample rate from the DAW
     currentSampleRate.store(sampleRate, std::memory_order_relaxed);
 
-    // Update buffer size if parameter changed
-    int newBufferSize = static_cast<int>(bufferSizeParam->load());
-    if (newBufferSize != analysisBufferSize.load())
-    {
-        analysisBufferSize.store(newBufferSize, std::memory_order_relaxed);
-        analysisBuffer.resize(newBufferSize, 0.0f);
-        processingBuffer.resize(newBufferSize, 0.0f);
-        hannWindow.resize(newBufferSize);
+    int newBufferSize = 0, newHopSize = 0;
+    getAnalysisSize(sampleRate, newBufferSize, newHopSize);
 
-        // Recalculate window
-        for (int i = 0; i < newBufferSize; ++i)
-        {
-            hannWindow[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (newBufferSize - 1)));
-        }
+    // Every input channel gets its own track (up to the engine's limit)
+    const int numChannels = juce::jlimit(1, PitchDetectionEngine::maxChannels, getTotalNumInputChannels());
 
-        // Force fresh buffer fill after resize
-        writePosition.store(0, std::memory_order_relaxed);
-        bufferReady.store(false, std::memory_order_relaxed);
-    }
+    // Keeps the buffer history if the channel count didn't change
+    engine.prepare(sampleRate, newBufferSize, newHopSize, numChannels);
+
+    for (auto& slot : analysisSlots)
+        engine.prepareSnapshot(slot);
+
+    analysisFifo.reset();
+    analysisRegistration.resetStats();
+    engine.resetSchedulingStats();
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    instrumentation.reset();
+   #endif
+
+    // Anything still scheduled belongs to the old configuration; release the held note instead
+    liveMidiFifo.reset();
+    liveMidiNote = -1;
+    liveMidiPitchBend = -1;
+    lastLiveMidiPosition = 0;
+    if (outputMidiNote >= 0)
+        scheduleLiveMidi(0, juce::MidiMessage::noteOff(liveMidiChannel, outputMidiNote));
+
+    updateLatency();
+    analysisRegistration.resume();
+}
+
+void PitchDetectorAudioProcessor::getAnalysisSize(double sampleRate, int& bufferSize, int& hopSize) const
+{
+    bufferSize = static_cast<int>(bufferSizeParam->load());
 
     // Calculate hop size based on update rate parameter
     const int updateRates[] = { 2, 4, 8, 12, 20, 30 };
-    int updateRateIndex = static_cast<int>(updateRateParam->load());
+    const int updateRateIndex = juce::jlimit(0, 5, static_cast<int>(updateRateParam->load()));
     int updatesPerSecond = updateRates[updateRateIndex];
 
     // Link buffer size to update rate for stability (N ≈ 2-4x hop)
-    int suggestedN = static_cast<int>(sampleRate / updatesPerSecond * 2);
-    if (newBufferSize > suggestedN * 2)
+    const int suggestedN = static_cast<int>(sampleRate / updatesPerSecond * 2);
+    if (bufferSize > suggestedN * 2)
     {
         // Cap update rate to prevent overload
-        updatesPerSecond = juce::jmin(updatesPerSecond, static_cast<int>(sampleRate / newBufferSize * 0.5));
+        updatesPerSecond = juce::jlimit(1, updatesPerSecond, static_cast<int>(sampleRate / bufferSize * 0.5));
     }
 
-    int newHopSize = static_cast<int>(sampleRate / updatesPerSecond);
-    currentHopSize.store(newHopSize, std::memory_order_relaxed);
-
-    dcBlockerX.store(0.0f, std::memory_order_relaxed);
-    dcBlockerY.store(0.0f, std::memory_order_relaxed);
-    samplesUntilNextAnalysis.store(0, std::memory_order_relaxed);
+    hopSize = static_cast<int>(sampleRate / updatesPerSecond);
 }
 
-void PitchDetectorAudioProcessor::releaseResources() {}
+void PitchDetectorAudioProcessor::releaseResources()
+{
+    analysisRegistration.pause();
+}
 
 bool PitchDetectorAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
-    // Support mono or stereo
+    // Any matching input/output layout from mono up to 16 channels (mic arrays, discrete multitrack buses)
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
 
-    return layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo() ||
-        layouts.getMainOutputChannelSet() == juce::AudioChannelSet::mono();
+    const int numChannels = layouts.getMainInputChannelSet().size();
+    return numChannels >= 1 && numChannels <= PitchDetectionEngine::maxChannels;
 }
 
 void PitchDetectorAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    RealtimeSafety::ScopedRealtimeSection realtimeSection;
 
     // CRITICAL: This is an ANALYSIS-ONLY plugin
     // Audio passes through 100% unmodified - we just READ from it
     // No processing, no modifications, completely transparent
 
-    // Get input for analysis only (channel 0)
-    const auto* channelData = buffer.getReadPointer(0);
+    // Get input for analysis only (every channel the engine was prepared for)
+    std::array<const float*, PitchDetectionEngine::maxChannels> channelData{};
+    for (int c = 0; c < engine.getNumChannels(); ++c)
+        channelData[static_cast<size_t>(c)] = buffer.getReadPointer(juce::jmin(c, buffer.getNumChannels() - 1));
+
     const int numSamples = buffer.getNumSamples();
 
     // Update time tracking
     double sr = currentSampleRate.load(std::memory_order_relaxed);
-    currentTime += numSamples / sr;
-    sampleCount += numSamples;
+    PITCHDETECTOR_TIME_CALLBACK(instrumentation, numSamples, sr);
+
+    const juce::int64 blockStartPosition = engine.getSamplePosition();
+    const double blockStartTime = currentTime.load(std::memory_order_relaxed);
+    currentTime.store(blockStartTime + numSamples / sr, std::memory_order_relaxed);
+
+    // Remember the host tempo for MIDI export
+    if (auto* playHead = getPlayHead())
+        if (const auto position = playHead->getPosition())
+            if (const auto bpm = position->getBpm())
+                hostBpm.store(*bpm, std::memory_order_relaxed);
 
     // Collect samples for pitch detection (doesn't affect audio output)
-    collectSamples(channelData, numSamples);
+    // The block is split at hop boundaries so each snapshot ends on the exact sample its hop completed;
+    // with adaptive scheduling an onset can move the next boundary closer
+    engine.setAdaptiveScheduling(adaptiveSchedulingParam->load() > 0.5f);
 
-    // Check if it's time to analyze
-    int currentCountdown = samplesUntilNextAnalysis.load(std::memory_order_relaxed);
-    currentCountdown -= numSamples;
-    samplesUntilNextAnalysis.store(currentCountdown, std::memory_order_relaxed);
+    // Instances someone is watching or playing from go ahead of the rest when the pool is busy
+    analysisRegistration.setPriority(editorOpen.load(std::memory_order_relaxed) || midiOutputParam->load() > 0.5f);
 
-    if (currentCountdown <= 0 && bufferReady.load(std::memory_order_relaxed))
+    // Size and rate changes take effect at the next hop without a re-prepare (the latency follows from the timer)
+    int analysisBufferSize = 0, analysisHopSize = 0;
+    getAnalysisSize(sr, analysisBufferSize, analysisHopSize);
+    engine.setAnalysisSize(analysisBufferSize, analysisHopSize);
+
+    bool hopsQueued = false;
+    for (int offset = 0; offset < numSamples;)
     {
-        int hopSize = currentHopSize.load(std::memory_order_relaxed);
-        samplesUntilNextAnalysis.store(hopSize, std::memory_order_relaxed);
-        runPitchDetection();
+        const int chunk = juce::jmin(numSamples - offset, engine.getSamplesUntilNextHop());
+
+        bool hopComplete = false;
+        {
+            PITCHDETECTOR_TIME_STAGE(instrumentation, collect);
+            hopComplete = engine.collect(channelData.data(), offset, chunk);
+        }
+
+        if (hopComplete)
+        {
+            pushAnalysisSnapshot(blockStartTime + (offset + chunk) / sr);
+            hopsQueued = true;
+        }
+
+        offset += chunk;
     }
+
+    // Only copy the window here - the analysis itself runs on the shared analysis service
+    // (waking one of its workers, when any is asleep, is the single kernel call left on the audio thread)
+    if (hopsQueued)
+        analysisRegistration.submit();
+
+    // Live pitch-to-MIDI: whatever the analysis thread scheduled inside this block
+    emitLiveMidi(midiMessages, blockStartPosition, numSamples);
 }
 
-void PitchDetectorAudioProcessor::collectSamples(const float* channelData, int numSamples)
+void PitchDetectorAudioProcessor::pushAnalysisSnapshot(double timeInSeconds)
 {
-    int currentBufferSize = analysisBufferSize.load(std::memory_order_relaxed);
-    int pos = writePosition.load(std::memory_order_relaxed);
-
-    float x = dcBlockerX.load(std::memory_order_relaxed);
-    float y = dcBlockerY.load(std::memory_order_relaxed);
+    const auto scope = analysisFifo.write(1);
 
-    for (int i = 0; i < numSamples; ++i)
+    if (scope.blockSize1 == 0)
     {
-        // Simple DC blocker
-        const float input = channelData[i];
-        const float output = input - x + 0.99f * y;
-        x = input;
-        y = output;
+        // Analysis is still busy with earlier hops - skip this one rather than block
+        analysisRegistration.recordDroppedJob();
+        return;
+    }
+
+    // Silent hops still go through the queue (so the display and log see the note end), just without the copy
+    auto& snapshot = analysisSlots[scope.startIndex1];
+    PITCHDETECTOR_TIME_STAGE(instrumentation, snapshot);
+    engine.takeSnapshot(snapshot);
+    snapshot.timeInSeconds = timeInSeconds;
+    analysisSubmitTicks[static_cast<size_t>(scope.startIndex1)] = juce::Time::getHighResolutionTicks();
+}
 
-        // Store in circular buffer
-        analysisBuffer[pos] = output;
-        pos++;
+void PitchDetectorAudioProcessor::drainAnalysisSnapshots()
+{
+    while (analysisFifo.getNumReady() > 0)
+    {
+        const auto scope = analysisFifo.read(1);
 
-        if (pos >= currentBufferSize)
+        if (scope.blockSize1 > 0)
         {
-            pos = 0;
-            // Once buffer is full, keep it ready (don't reset to false)
-            if (!bufferReady.load(std::memory_order_relaxed))
-                bufferReady.store(true, std::memory_order_relaxed);
+            analysisRegistration.recordQueueLatency(analysisSubmitTicks[static_cast<size_t>(scope.startIndex1)]);
+            runPitchDetection(analysisSlots[scope.startIndex1]);
         }
     }
-
-    dcBlockerX.store(x, std::memory_order_relaxed);
-    dcBlockerY.store(y, std::memory_order_relaxed);
-    writePosition.store(pos, std::memory_order_relaxed);
 }
 
-void PitchDetectorAudioProcessor::runPitchDetection()
+void PitchDetectorAudioProcessor::runPitchDetection(const AnalysisSnapshot& snapshot)
 {
-    int currentBufferSize = analysisBufferSize.load(std::memory_order_relaxed);
-    int wp = writePosition.load(std::memory_order_relaxed);
+    PITCHDETECTOR_TIME_STAGE(instrumentation, analysis);
 
-    // CRITICAL FIX: Copy circular buffer in sequential order (oldest to newest)
-    // writePosition points to next write location = start of oldest data
-    for (int i = 0; i < currentBufferSize; ++i)
-    {
-        int buf_idx = (wp + i) % currentBufferSize;
-        processingBuffer[i] = analysisBuffer[buf_idx] * hannWindow[i];
-    }
+    // Detect pitch (a mono result is published as a one-voice frame)
+    engine.setMultiResolution(multiResolutionParam->load() > 0.5f);
+    engine.setPitchTracking(pitchTrackingParam->load() > 0.5f);
+    engine.setDetector(static_cast<PitchDetectionEngine::Detector>(
+        juce::jlimit(0, PitchDetectionEngine::numDetectors - 1, static_cast<int>(detectorParam->load()))));
 
-    // Detect pitch
-    double sr = currentSampleRate.load(std::memory_order_relaxed);
-    const float frequency = detectPitchYIN(processingBuffer.data(), currentBufferSize, sr);
+    PolyphonicFrame frame;
+    const bool polyphonic = polyphonicParam->load() > 0.5f;
+
+    // Channels are independent, so idle workers in the shared pool pick some of them up
+    std::array<PitchDetectionEngine::Result, PitchDetectionEngine::maxChannels> results;
+    analysisService->parallelFor(snapshot.numChannels, [&](int channel)
+        {
+            PITCHDETECTOR_TIME_STAGE(instrumentation, detect);
+            results[static_cast<size_t>(channel)] = (channel == 0 && polyphonic) ? engine.analysePolyphonic(snapshot, frame, 0)
+                                                                                   : engine.analyse(snapshot, channel);
+        });
+
+    for (int c = 0; c < snapshot.numChannels; ++c)
+        channelFrequencies[static_cast<size_t>(c)].store(results[static_cast<size_t>(c)].frequency, std::memory_order_relaxed);
 
+    numAnalysedChannels.store(snapshot.numChannels, std::memory_order_relaxed);
+
+    // Channel 0 drives the display and the live MIDI output; every channel is logged
+    const auto& result = results[0];
+    const float frequency = result.frequency;
+
+    if (!polyphonic)
+        frame = makeMonoFrame(snapshot.timeInSeconds, frequency);
+
+    currentVoices.store(frame);
     detectedFrequency.store(frequency, std::memory_order_relaxed);
+    detectedConfidence.store(result.confidence, std::memory_order_relaxed);
+    updateLiveMidi(snapshot, frequency, result.rms);
 
     if (frequency > 0.0f)
     {
-        frequencyToNote(frequency);
-
-        // Log pitch if recording
-        if (recording.load(std::memory_order_relaxed))
-        {
-            // Calculate MIDI note
-            const float midiNoteFloat = 12.0f * std::log2(frequency / 440.0f) + 69.0f;
-            const int midiNote = static_cast<int>(std::round(midiNoteFloat));
-
-            // Only log if note changed or enough time passed (avoid duplicates)
-            if (midiNote != lastMidiNote || (currentTime - lastNoteTime) > 0.1)
-            {
-                // Calculate velocity based on RMS (0-127)
-                float rms = 0.0f;
-                for (int i = 0; i < currentBufferSize; i += 4)
-                    rms += processingBuffer[i] * processingBuffer[i];
-                rms = std::sqrt(rms / (currentBufferSize / 4));
-                float velocity = juce::jlimit(0.0f, 127.0f, rms * 1000.0f);
-
-                PitchEvent event;
-                event.timeInSeconds = currentTime - recordingStartTime;
-                event.frequency = frequency;
-                event.midiNote = midiNote;
-                event.velocity = velocity;
-
-                juce::ScopedLock lock(pitchLogLock);
-                pitchLog.push_back(event);
-
-                lastMidiNote = midiNote;
-                lastNoteTime = currentTime;
-            }
-        }
+        frequencyToNote(getTuning(), frequency);
     }
     else
     {
-        juce::ScopedLock lock(noteNameLock);
-        noteName = "---";
+        publishNoteName("---");
         centsOffset.store(0.0f, std::memory_order_relaxed);
-        lastMidiNote = -1;
     }
-}
 
-float PitchDetectorAudioProcessor::detectPitchYIN(const float* buffer, int numSamples, double sampleRate, float threshold)
-{
-    // Improved RMS check with better subsampling
-    float rms = 0.0f;
-    int step = 2;
-    int count = 0;
-    for (int i = 0; i < numSamples; i += step)
+    const bool isLogging = recording.load(std::memory_order_relaxed);
+
+    if (isLogging && noteTrackingResetPending.exchange(false, std::memory_order_acquire))
     {
-        rms += buffer[i] * buffer[i];
-        ++count;
+        for (auto& notes : lastLoggedNotes)
+            notes.reset();
+
+        lastNoteTimes.fill(0.0);
     }
-    rms = std::sqrt(rms / count);
 
-    if (rms < 0.01f) // Raised threshold for quieter signals
-        return 0.0f;
+    for (int c = 0; c < snapshot.numChannels; ++c)
+    {
+        const auto& channelResult = results[static_cast<size_t>(c)];
+        logChannel(c, c == 0 ? frame : makeMonoFrame(snapshot.timeInSeconds, channelResult.frequency),
+                   channelResult, snapshot.timeInSeconds, isLogging);
+    }
+}
 
-    const int halfSize = numSamples / 2;
-    std::vector<float> diff(halfSize);
+PolyphonicFrame PitchDetectorAudioProcessor::makeMonoFrame(double timeInSeconds, float frequency)
+{
+    // A mono result is published and logged as a one-voice frame
+    PolyphonicFrame frame;
+    frame.timeInSeconds = timeInSeconds;
+    frame.numVoices = frequency > 0.0f ? 1 : 0;
+    frame.frequency[0] = frequency;
+    frame.salience[0] = 1.0f;
+    return frame;
+}
 
-    // FIXED: YIN difference function with proper overlap
-    for (int tau = 0; tau < halfSize; ++tau)
+void PitchDetectorAudioProcessor::logChannel(int channel, const PolyphonicFrame& frame, const PitchDetectionEngine::Result& result,
+                                             double timeInSeconds, bool isLogging)
+{
+    auto& loggedNotes = lastLoggedNotes[static_cast<size_t>(channel)];
+    auto& lastNoteTime = lastNoteTimes[static_cast<size_t>(channel)];
+
+    if (result.frequency <= 0.0f)
     {
-        float sum = 0.0f;
-        int max_i = numSamples - tau; // Standard YIN: full overlap for each tau
-        for (int i = 0; i < max_i; ++i)
+        // Mark where the note ended so the MIDI export can close it
+        if (isLogging && loggedNotes.any())
         {
-            const float delta = buffer[i] - buffer[i + tau];
-            sum += delta * delta;
+            PitchEvent rest;
+            rest.timeInSeconds = timeInSeconds - recordingStartTime.load(std::memory_order_relaxed);
+            rest.frequency = 0.0f;
+            rest.midiNote = -1;
+            rest.velocity = 0.0f;
+            rest.channel = channel;
+            logPitchEvent(rest);
         }
-        diff[tau] = sum;
+
+        loggedNotes.reset();
+        return;
     }
 
-    // Cumulative mean normalized difference
-    diff[0] = 0.0f; // Standard YIN initialization
-    float runningSum = 0.0f;
+    if (!isLogging)
+        return;
+
+    // Logged notes are MIDI notes at 12-TET, A4 = 440 Hz, like the live output: the exporter bends
+    // from them to the logged frequency, so the tuning parameters only affect what is displayed
+    std::bitset<128> notes;
+    int midiNotes[PolyphonicFrame::maxVoices];
 
-    for (int tau = 1; tau < halfSize; ++tau)
+    for (int v = 0; v < frame.numVoices; ++v)
     {
-        runningSum += diff[tau];
-        if (runningSum > 0.0f)
-            diff[tau] *= tau / runningSum;
+        midiNotes[v] = Tuning::standard.lookup(frame.frequency[v]).midiNote;
+
+        if (midiNotes[v] >= 0 && !notes.test(midiNotes[v]))
+            notes.set(midiNotes[v]);
         else
-            diff[tau] = 1.0f;
+            midiNotes[v] = -1;
     }
 
-    // Optimized search range for human voice/instruments (70 Hz - 1200 Hz)
-    // For guitar down to E2 (82 Hz), use /60.0 for maxTau
-    const int minTau = juce::jmax(4, static_cast<int>(sampleRate / 1200.0)); // Up to C7
-    const int maxTau = juce::jmin(halfSize - 2, static_cast<int>(sampleRate / 70.0)); // Down to G1
+    // Only log if the notes changed or enough time passed (avoid duplicates)
+    if (!notes.any() || (notes == loggedNotes && (timeInSeconds - lastNoteTime) <= 0.1))
+        return;
 
-    int bestTau = 0;
+    // Calculate velocity based on RMS (0-127)
+    const float velocity = juce::jlimit(0.0f, 127.0f, result.rms * 1000.0f);
 
-    // Find first local minimum below threshold
-    for (int tau = minTau; tau < maxTau; ++tau)
+    // Chords are logged as one event per voice sharing a timestamp
+    for (int v = 0; v < frame.numVoices; ++v)
     {
-        if (diff[tau] < threshold)
-        {
-            if (diff[tau] < diff[tau - 1] && diff[tau] < diff[tau + 1])
-            {
-                bestTau = tau;
-                break;
-            }
-        }
+        if (midiNotes[v] < 0)
+            continue;
+
+        PitchEvent event;
+        event.timeInSeconds = timeInSeconds - recordingStartTime.load(std::memory_order_relaxed);
+        event.frequency = frame.frequency[v];
+        event.midiNote = midiNotes[v];
+        event.velocity = velocity;
+        event.channel = channel;
+        logPitchEvent(event);
     }
 
-    // Fallback to global minimum
-    if (bestTau == 0)
+    loggedNotes = notes;
+    lastNoteTime = timeInSeconds;
+}
+
+void PitchDetectorAudioProcessor::logPitchEvent(const PitchEvent& event)
+{
+    // Hand off to the message thread; never wait on the log here
+    const auto scope = pitchEventFifo.write(1);
+    if (scope.blockSize1 > 0)
+        pitchEventQueue[scope.startIndex1] = event;
+    else
+        droppedPitchEvents.fetch_add(1, std::memory_order_relaxed);
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    instrumentation.recordLogQueueDepth(pitchEventFifo.getNumReady());
+   #endif
+}
+
+void PitchDetectorAudioProcessor::updateLiveMidi(const AnalysisSnapshot& snapshot, float frequency, float rms)
+{
+    // One hop of slack gives this thread time to finish before processBlock reaches the event;
+    // the window length plus this delay is what gets reported as latency. When the hop shrinks, the
+    // new hop's events would land before the old one's, so they wait for them to keep the queue in
+    // time order (emitLiveMidi relies on that, and a noteOff must never overtake its noteOn).
+    const juce::int64 position = juce::jmax(snapshot.endSamplePosition + engine.getHopSize(), lastLiveMidiPosition);
+    lastLiveMidiPosition = position;
+
+    const bool enabled = midiOutputParam->load() > 0.5f;
+    // Receivers assume 12-TET at 440 Hz, so the tuning parameters never reach the MIDI output;
+    // whatever a temperament would change comes through in the pitch bend instead
+    const auto nearest = Tuning::standard.lookup(frequency);
+    const int nearestNote = nearest.midiNote;
+    const float midiNoteFloat = static_cast<float>(nearestNote) + nearest.cents * 0.01f;
+
+    if (!enabled || nearestNote < 0)
     {
-        float minVal = 1.0f;
-        for (int tau = minTau; tau < maxTau; ++tau)
-        {
-            if (diff[tau] < minVal)
-            {
-                minVal = diff[tau];
-                bestTau = tau;
-            }
-        }
+        if (liveMidiNote >= 0)
+            scheduleLiveMidi(position, juce::MidiMessage::noteOff(liveMidiChannel, liveMidiNote));
+
+        liveMidiNote = -1;
+        return;
     }
 
-    if (bestTau < 2 || bestTau >= halfSize - 1)
-        return 0.0f;
+    // Hysteresis: hold the sounding note until the pitch is clearly nearer another one
+    const bool changeNote = liveMidiNote < 0 || std::abs(midiNoteFloat - liveMidiNote) > 0.5f + liveMidiHysteresis;
+    const int note = changeNote ? nearestNote : liveMidiNote;
 
-    // Parabolic interpolation
-    const float s0 = diff[bestTau - 1];
-    const float s1 = diff[bestTau];
-    const float s2 = diff[bestTau + 1];
+    // Bend relative to the held note, so slides within the hysteresis band stay continuous
+    const int pitchBend = juce::MidiMessage::pitchbendToPitchwheelPos(midiNoteFloat - note, liveMidiBendRange);
 
-    float refinedTau = static_cast<float>(bestTau);
-    const float denom = (s0 - 2.0f * s1 + s2);
-    if (std::abs(denom) > 0.0001f)
+    if (changeNote && liveMidiNote >= 0)
+        scheduleLiveMidi(position, juce::MidiMessage::noteOff(liveMidiChannel, liveMidiNote));
+
+    if (pitchBend != liveMidiPitchBend)
+    {
+        scheduleLiveMidi(position, juce::MidiMessage::pitchWheel(liveMidiChannel, pitchBend));
+        liveMidiPitchBend = pitchBend;
+    }
+
+    if (changeNote)
     {
-        const float offset = 0.5f * (s0 - s2) / denom;
-        refinedTau += juce::jlimit(-1.0f, 1.0f, offset);
+        const auto velocity = static_cast<juce::uint8>(juce::jlimit(1, 127, juce::roundToInt(rms * 1000.0f)));
+        scheduleLiveMidi(position, juce::MidiMessage::noteOn(liveMidiChannel, note, velocity));
+        liveMidiNote = note;
     }
+}
 
-    const float frequency = static_cast<float>(sampleRate / refinedTau);
-    return (frequency >= 16.0f && frequency <= 26000.0f) ? frequency : 0.0f;
+void PitchDetectorAudioProcessor::scheduleLiveMidi(juce::int64 samplePosition, const juce::MidiMessage& message)
+{
+    const auto scope = liveMidiFifo.write(1);
+    if (scope.blockSize1 > 0)
+        liveMidiQueue[scope.startIndex1] = { samplePosition, message };
 }
 
-void PitchDetectorAudioProcessor::frequencyToNote(float frequency)
+void PitchDetectorAudioProcessor::emitLiveMidi(juce::MidiBuffer& midiMessages, juce::int64 blockStartPosition, int numSamples)
 {
-    if (frequency < 16.0f || frequency > 26000.0f)
+    int start1, size1, start2, size2;
+    liveMidiFifo.prepareToRead(liveMidiFifo.getNumReady(), start1, size1, start2, size2);
+
+    // Events are queued in time order; stop at the first one that belongs to a later block
+    int numEmitted = 0;
+    for (; numEmitted < size1 + size2; ++numEmitted)
     {
-        juce::ScopedLock lock(noteNameLock);
-        noteName = "Out of Range";
-        centsOffset.store(0.0f, std::memory_order_relaxed);
-        return;
+        const auto& scheduled = liveMidiQueue[numEmitted < size1 ? start1 + numEmitted : start2 + numEmitted - size1];
+        const juce::int64 offset = scheduled.samplePosition - blockStartPosition;
+
+        if (offset >= numSamples)
+            break;
+
+        // Late results (analysis fell behind) go out at the start of the block
+        midiMessages.addEvent(scheduled.message, static_cast<int>(juce::jmax(static_cast<juce::int64>(0), offset)));
+
+        if (scheduled.message.isNoteOn())
+            outputMidiNote = scheduled.message.getNoteNumber();
+        else if (scheduled.message.isNoteOff())
+            outputMidiNote = -1;
     }
 
-    const float midiNote = 12.0f * std::log2(frequency / 440.0f) + 69.0f;
-    const int nearestNote = static_cast<int>(std::round(midiNote));
-    const float cents = (midiNote - nearestNote) * 100.0f;
-    centsOffset.store(cents, std::memory_order_relaxed);
+    liveMidiFifo.finishedRead(numEmitted);
+}
+
+void PitchDetectorAudioProcessor::updateLatency()
+{
+    // Only the MIDI output is late; the audio itself passes through untouched
+    const int latency = midiOutputParam->load() > 0.5f ? getLiveMidiLatencySamples() : 0;
 
-    const char* noteNames[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-    const char* noteNamesFlat[] = { "C", "Db", "D", "Eb", "E", "F", "Gb", "G", "Ab", "A", "Bb", "B" };
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
 
-    const int noteInOctave = nearestNote % 12;
-    const int octave = (nearestNote / 12) - 1;
+void PitchDetectorAudioProcessor::frequencyToNote(const Tuning::Table& tuning, float frequency)
+{
+    PITCHDETECTOR_TIME_STAGE(instrumentation, noteMapping);
 
-    juce::String newNoteName;
-    if (cents < -25.0f && noteInOctave > 0)
-        newNoteName = juce::String(noteNamesFlat[noteInOctave]) + juce::String(octave);
-    else if (cents > 25.0f && noteInOctave < 11)
-        newNoteName = juce::String(noteNames[noteInOctave]) + juce::String(octave);
-    else
-        newNoteName = juce::String(noteNames[noteInOctave]) + juce::String(octave);
+    const auto note = tuning.lookup(frequency);
+    if (note.midiNote < 0)
+    {
+        publishNoteName("Out of Range");
+        centsOffset.store(0.0f, std::memory_order_relaxed);
+        return;
+    }
+
+    centsOffset.store(note.cents, std::memory_order_relaxed);
 
-    juce::ScopedLock lock(noteNameLock);
-    noteName = newNoteName;
+    // Names are formatted at compile time; more than 25 cents flat, the note is spelled as a flat
+    const auto& names = note.cents < -25.0f ? Tuning::flatNames : Tuning::sharpNames;
+    publishNoteName(names[static_cast<size_t>(note.midiNote)].text);
 }
 
 void PitchDetectorAudioProcessor::startRecording()
 {
-    juce::ScopedLock lock(pitchLogLock);
+    // Discard anything still queued from a previous take
+    pitchEventFifo.read(pitchEventFifo.getNumReady());
+
     pitchLog.clear();
-    recordingStartTime = currentTime;
-    lastMidiNote = -1;
-    lastNoteTime = 0.0;
+    recordingStartTime.store(currentTime.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    noteTrackingResetPending.store(true, std::memory_order_release);
     recording.store(true, std::memory_order_relaxed);
 }
 
 void PitchDetectorAudioProcessor::stopRecording()
 {
     recording.store(false, std::memory_order_relaxed);
+    recordingLength.store(currentTime.load(std::memory_order_relaxed) - recordingStartTime.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
 }
 
 void PitchDetectorAudioProcessor::clearRecording()
 {
-    juce::ScopedLock lock(pitchLogLock);
+    pitchEventFifo.read(pitchEventFifo.getNumReady());
+
     pitchLog.clear();
-    lastMidiNote = -1;
+    noteTrackingResetPending.store(true, std::memory_order_release);
+}
+
+bool PitchDetectorAudioProcessor::exportMidiFile(const juce::File& file, MidiFileExporter::Settings settings) const
+{
+    if (settings.bpm <= 0.0)
+    {
+        const double bpm = hostBpm.load(std::memory_order_relaxed);
+        settings.bpm = bpm > 0.0 ? bpm : 120.0;
+    }
+
+    file.deleteFile();
+    juce::FileOutputStream output(file);
+    if (!output.openedOk())
+        return false;
+
+    MidiFileExporter exporter(output, settings);
+
+    // Straight from the log's chunks (spilled ones are read back one at a time), no copy of the recording
+    pitchLog.visit(0, [&exporter](const PitchEvent* events, int numEvents)
+        {
+            for (int i = 0; i < numEvents; ++i)
+                exporter.addEvent(events[i]);
+
+            return true;
+        });
+
+    const double endTime = isRecording() ? -1.0 : recordingLength.load(std::memory_order_relaxed);
+    return exporter.finish(endTime > 0.0 ? endTime : -1.0) && output.getStatus().wasOk();
+}
+
+void PitchDetectorAudioProcessor::timerCallback()
+{
+    drainPitchEvents();
+    updateLatency();
+    updateTuning();
+}
+
+void PitchDetectorAudioProcessor::updateTuning()
+{
+    const double referencePitch = referencePitchParam->load();
+    const int temperament = static_cast<int>(temperamentParam->load());
+    const auto& scale = temperament == 1 ? Tuning::justIntonation
+                      : temperament == 2 ? scalaScale
+                                         : Tuning::equalTemperament();
+
+    const auto& current = getTuning();
+    if (current.getReferencePitch() != referencePitch || !(current.getScale() == scale))
+        tuningTable.store(&Tuning::getTable(referencePitch, scale), std::memory_order_release);
 }
 
-std::vector<PitchDetectorAudioProcessor::PitchEvent> PitchDetectorAudioProcessor::getPitchLog() const
+bool PitchDetectorAudioProcessor::loadScalaFile(const juce::File& file, juce::String& error)
 {
-    juce::ScopedLock lock(pitchLogLock);
-    return pitchLog;
+    const auto text = file.loadFileAsString();
+    Tuning::Scale scale;
+    juce::String description;
+    if (!Tuning::parseScala(text, scale, description, error))
+        return false;
+
+    scalaScale = scale;
+    scalaDescription = description.isNotEmpty() ? description : file.getFileNameWithoutExtension();
+
+    // The scale itself goes into the state, so the session does not depend on the file staying put
+    parameters.state.setProperty("scalaFile", text, nullptr);
+    parameters.state.setProperty("scalaName", scalaDescription, nullptr);
+
+    if (auto* temperament = parameters.getParameter("temperament"))
+        temperament->setValueNotifyingHost(temperament->convertTo0to1(2.0f));
+
+    updateTuning();
+    return true;
 }
 
+void PitchDetectorAudioProcessor::drainPitchEvents()
+{
+    const int numReady = pitchEventFifo.getNumReady();
+    if (numReady == 0)
+        return;
+
+    const auto scope = pitchEventFifo.read(numReady);
+    pitchLog.append(pitchEventQueue.data() + scope.startIndex1, scope.blockSize1);
+    pitchLog.append(pitchEventQueue.data() + scope.startIndex2, scope.blockSize2);
+}
+
+#if PITCHDETECTOR_INSTRUMENTATION
+Instrumentation::Report PitchDetectorAudioProcessor::getInstrumentationReport() const
+{
+    auto report = instrumentation.getReport();
+    const auto queueStats = getAnalysisQueueStats();
+    report.droppedHops = static_cast<int>(queueStats.droppedJobs);
+    report.meanQueueLatencyMs = queueStats.meanLatencyMs;
+    report.maxQueueLatencyMs = queueStats.maxLatencyMs;
+    report.silentFrames = getSchedulingStats().skippedFrames;
+    report.droppedPitchEvents = getDroppedPitchEventCount();
+    return report;
+}
+
+void PitchDetectorAudioProcessor::resetInstrumentation()
+{
+    instrumentation.reset();
+}
+#endif
+
 bool PitchDetectorAudioProcessor::hasEditor() const { return true; }
 juce::AudioProcessorEditor* PitchDetectorAudioProcessor::createEditor() { return new PitchDetectorAudioProcessorEditor(*this); }
 
@@ -404,6 +680,20 @@ void PitchDetectorAudioProcessor::getStateInformation(juce::MemoryBlock& destDat
     auto state = parameters.copyState();
     std::unique_ptr<juce::XmlElement> xml(state.createXml());
     copyXmlToBinary(*xml, destData);
+
+    // The recording follows the parameters as a pitch track, so a session reopens with it
+    if (pitchLog.size() > 0)
+    {
+        PitchTrackWriter track;
+        pitchLog.visit(0, [&track](const PitchEvent* events, int numEvents)
+            {
+                track.add(events, numEvents);
+                return true;
+            });
+
+        juce::MemoryOutputStream output(destData, true);
+        track.writeTo(output);
+    }
 }
 
 void PitchDetectorAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
@@ -412,6 +702,74 @@ void PitchDetectorAudioProcessor::setStateInformation(const void* data, int size
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName(parameters.state.getType()))
             parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
+
+    // Everything else is decoded on the calling thread and applied on the message thread
+    auto restored = std::make_shared<RestoredState>();
+
+    const auto scalaText = parameters.state.getProperty("scalaFile").toString();
+    juce::String error;
+    if (scalaText.isNotEmpty() && Tuning::parseScala(scalaText, restored->scalaScale, restored->scalaDescription, error))
+    {
+        restored->hasScala = true;
+        restored->scalaDescription = parameters.state.getProperty("scalaName", restored->scalaDescription).toString();
+    }
+
+    // Any pitch track comes after the XML block (magic, text length, text, terminator); states
+    // saved without one simply end there
+    if (xmlState != nullptr && sizeInBytes > 8)
+    {
+        const auto* bytes = static_cast<const juce::uint8*>(data);
+        const size_t xmlSize = 9 + static_cast<size_t>(juce::ByteOrder::littleEndianInt(bytes + 4));
+
+        if (xmlSize < static_cast<size_t>(sizeInBytes))
+            restored->hasRecording = decodeRecording(bytes + xmlSize, static_cast<size_t>(sizeInBytes) - xmlSize, restored->recording);
+    }
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        applyRestoredState(*restored);
+        return;
+    }
+
+    juce::MessageManager::callAsync([processor = juce::WeakReference<PitchDetectorAudioProcessor>(this), restored]()
+        {
+            if (auto* p = processor.get())
+                p->applyRestoredState(*restored);
+        });
+}
+
+bool PitchDetectorAudioProcessor::decodeRecording(const void* data, size_t size, std::vector<PitchEvent>& events)
+{
+    PitchTrackReader track;
+    if (!track.open(data, size))
+        return false;
+
+    events.resize(static_cast<size_t>(track.getNumEvents()));
+    events.resize(static_cast<size_t>(track.read(0, events.data(), track.getNumEvents())));
+    return true;
+}
+
+void PitchDetectorAudioProcessor::applyRestoredState(const RestoredState& state)
+{
+    if (state.hasScala)
+    {
+        scalaScale = state.scalaScale;
+        scalaDescription = state.scalaDescription;
+    }
+
+    updateTuning();
+
+    if (!state.hasRecording)
+        return;
+
+    // Replaces the log; the editor sees the recording stop on its next timer tick
+    recording.store(false, std::memory_order_relaxed);
+    pitchEventFifo.read(pitchEventFifo.getNumReady());
+    pitchLog.clear();
+    pitchLog.append(state.recording.data(), static_cast<int>(state.recording.size()));
+
+    recordingLength.store(state.recording.empty() ? 0.0 : state.recording.back().timeInSeconds, std::memory_order_relaxed);
+    noteTrackingResetPending.store(true, std::memory_order_release);
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new PitchDetectorAudioProcessor(); }
\ No newline at end of file
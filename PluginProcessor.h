@@ -1,8 +1,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <bitset>
+#include "RealtimeSafety.h"
+#include "Instrumentation.h"
+#include "PitchDetectionEngine.h"
+#include "PitchEvent.h"
+#include "Tuning.h"
+#include "PitchLog.h"
+#include "PitchTrackFile.h"
+#include "MidiFileExporter.h"
+#include "AnalysisService.h"
 
-class PitchDetectorAudioProcessor : public juce::AudioProcessor
+class PitchDetectorAudioProcessor : public juce::AudioProcessor,
+    private juce::Timer
 {
 public:
     PitchDetectorAudioProcessor();
@@ -39,73 +50,247 @@ public:
     juce::String getNoteName() const;
     float getCentsOffset() const { return centsOffset.load(std::memory_order_relaxed); }
 
+    // The note name and cents follow the referencePitch and temperament parameters; the table is
+    // swapped in by the message thread and shared with every other instance using it
+    const Tuning::Table& getTuning() const { return *tuningTable.load(std::memory_order_acquire); }
+
+    // Message thread. Reads a 12-note Scala scale, keeps it in the plugin state and switches the
+    // temperament to it; on failure the current tuning stays and error says why
+    bool loadScalaFile(const juce::File& file, juce::String& error);
+    juce::String getScalaDescription() const { return scalaDescription; }
+
+    // 0..1 from whichever detector decided the latest frame (see PitchDetectionEngine::Result)
+    float getDetectedConfidence() const { return detectedConfidence.load(std::memory_order_relaxed); }
+
+    // Every pitch in the latest frame, strongest first (one voice unless polyphonic mode is on)
+    PolyphonicFrame getCurrentVoices() const { return currentVoices.load(); }
+
+    // Independent per-channel tracks, each logged with its channel; channel 0 also drives the
+    // display and the live MIDI output
+    int getNumAnalysedChannels() const { return numAnalysedChannels.load(std::memory_order_relaxed); }
+    float getChannelFrequency(int channel) const { return channelFrequencies[static_cast<size_t>(channel)].load(std::memory_order_relaxed); }
+
     // Parameter accessor
     juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
 
+    // YIN difference function strategy (see PitchDetectionEngine::DifferenceMethod)
+    using DifferenceMethod = PitchDetectionEngine::DifferenceMethod;
+    void setDifferenceMethod(DifferenceMethod method) { engine.setDifferenceMethod(method); }
+    DifferenceMethod getDifferenceMethod() const { return engine.getDifferenceMethod(); }
+
     // Pitch logging
-    struct PitchEvent
-    {
-        double timeInSeconds;
-        float frequency;
-        int midiNote;
-        float velocity;
-    };
+    using PitchEvent = ::PitchEvent;
 
     void startRecording();
     void stopRecording();
     bool isRecording() const { return recording.load(std::memory_order_relaxed); }
     void clearRecording();
-    std::vector<PitchEvent> getPitchLog() const;
     int getLogSize() const { return pitchLog.size(); }
 
+    // Read through PitchLog::visit() (spans, no copy); the log itself is only written by the message thread
+    const PitchLog& getPitchLog() const { return pitchLog; }
+
+    // Writes the log as a Standard MIDI File, streaming it span by span rather than copying it.
+    // A bpm of 0 uses the host tempo when the play head has reported one, otherwise 120.
+    bool exportMidiFile(const juce::File& file, MidiFileExporter::Settings settings) const;
+
+    // Last tempo reported by the host's play head, or 0 if there has been none
+    double getHostBpm() const { return hostBpm.load(std::memory_order_relaxed); }
+
+    // Events lost because the log queue was full when the analysis thread produced them
+    int getDroppedPitchEventCount() const { return droppedPitchEvents.load(std::memory_order_relaxed); }
+
+    // Hops skipped because analysis had not caught up
+    int getDroppedAnalysisCount() const { return static_cast<int>(analysisRegistration.getStats().droppedJobs); }
+
+    // Time hops wait in the shared analysis service before they run, since prepareToPlay
+    AnalysisService::QueueStats getAnalysisQueueStats() const { return analysisRegistration.getStats(); }
+
+    // The editor reports itself so this instance's analysis is scheduled ahead of hidden ones
+    void setEditorOpen(bool isOpen) { editorOpen.store(isOpen, std::memory_order_relaxed); }
+
+    // Full, verified and skipped channel-frames plus early onset hops since prepareToPlay
+    PitchDetectionEngine::SchedulingStats getSchedulingStats() const { return engine.getSchedulingStats(); }
+
+    // Frames and mean time per frame of each detector since prepareToPlay
+    PitchDetectionEngine::DetectorStats getDetectorStats(PitchDetectionEngine::Detector detector) const { return engine.getDetectorStats(detector); }
+
+    // Live pitch-to-MIDI latency: a note is emitted one hop after the window that detected it
+    int getLiveMidiLatencySamples() const { return engine.getBufferSize() + engine.getHopSize(); }
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    // Per-stage timings and callback load since the last reset, with the drop and skip counts above
+    Instrumentation::Report getInstrumentationReport() const;
+    void resetInstrumentation();
+   #endif
+
 private:
+    using AnalysisSnapshot = PitchDetectionEngine::Snapshot;
+
+    // Runs pitch detection on the shared analysis service; submitted by processBlock each hop
+    class AnalysisJob : public AnalysisService::Client
+    {
+    public:
+        explicit AnalysisJob(PitchDetectorAudioProcessor& p) : owner(p) {}
+        void runAnalysis() override { owner.drainAnalysisSnapshots(); }
+
+    private:
+        PitchDetectorAudioProcessor& owner;
+    };
+
+    // Lets a long frame's difference function use idle workers in the shared service
+    class ParallelRunner : public PitchDetectionEngine::TaskRunner
+    {
+    public:
+        explicit ParallelRunner(AnalysisService& s) : service(s) {}
+
+        void run(int numTasks, void (*task)(void*, int), void* context) override
+        {
+            service.parallelFor(numTasks, [task, context](int index) { task(context, index); });
+        }
+
+    private:
+        AnalysisService& service;
+    };
+
+    // Preformatted note name, published without locks or allocation
+    struct NoteDisplay
+    {
+        char name[16];
+    };
+
+    // Window and hop from the bufferSize and updateRate parameters; real-time safe
+    void getAnalysisSize(double sampleRate, int& bufferSize, int& hopSize) const;
+
     // Background pitch detection
-    void collectSamples(const float* channelData, int numSamples);
-    void runPitchDetection();
-    float detectPitchYIN(const float* buffer, int numSamples, double sampleRate, float threshold = 0.15f);
-    void frequencyToNote(float frequency);
+    void pushAnalysisSnapshot(double timeInSeconds);
+    void drainAnalysisSnapshots();
+    void runPitchDetection(const AnalysisSnapshot& snapshot);
+    void frequencyToNote(const Tuning::Table& tuning, float frequency);
+    void logPitchEvent(const PitchEvent& event);
+    void logChannel(int channel, const PolyphonicFrame& frame, const PitchDetectionEngine::Result& result,
+                    double timeInSeconds, bool isLogging);
+    static PolyphonicFrame makeMonoFrame(double timeInSeconds, float frequency);
+
+    // Live MIDI output: decided on the analysis thread, emitted by processBlock at a fixed delay
+    struct ScheduledMidi
+    {
+        juce::int64 samplePosition;
+        juce::MidiMessage message;
+    };
+
+    void updateLiveMidi(const AnalysisSnapshot& snapshot, float frequency, float rms);
+    void scheduleLiveMidi(juce::int64 samplePosition, const juce::MidiMessage& message);
+    void emitLiveMidi(juce::MidiBuffer& midiMessages, juce::int64 blockStartPosition, int numSamples);
+    void updateLatency();
+    void publishNoteName(const char* name);
+
+    // Message-thread consumer for the pitch event queue
+    void timerCallback() override;
+    void drainPitchEvents();
+
+    // Message thread: publishes the table for the current reference pitch and temperament
+    void updateTuning();
+
+    // What setStateInformation decoded beyond the parameters. Hosts may restore state from any
+    // thread, so it is parsed there and applied on the message thread, which owns the log, the
+    // event queue's consumer side and the Scala scale.
+    struct RestoredState
+    {
+        bool hasScala = false;
+        Tuning::Scale scalaScale;
+        juce::String scalaDescription;
+
+        bool hasRecording = false;
+        std::vector<PitchEvent> recording;
+    };
+
+    static bool decodeRecording(const void* data, size_t size, std::vector<PitchEvent>& events);
+    void applyRestoredState(const RestoredState& state);
 
     // Parameters
     juce::AudioProcessorValueTreeState parameters;
     std::atomic<float>* bufferSizeParam = nullptr;
     std::atomic<float>* updateRateParam = nullptr;
+    std::atomic<float>* multiResolutionParam = nullptr;
+    std::atomic<float>* midiOutputParam = nullptr;
+    std::atomic<float>* polyphonicParam = nullptr;
+    std::atomic<float>* adaptiveSchedulingParam = nullptr;
+    std::atomic<float>* pitchTrackingParam = nullptr;
+    std::atomic<float>* detectorParam = nullptr;
+    std::atomic<float>* referencePitchParam = nullptr;
+    std::atomic<float>* temperamentParam = nullptr;
+
+    // The loaded Scala scale (message thread) and the table the analysis thread maps notes with
+    Tuning::Scale scalaScale = Tuning::equalTemperament();
+    juce::String scalaDescription;
+    std::atomic<const Tuning::Table*> tuningTable{ &Tuning::standard };
 
-    // Audio buffers (circular buffer approach)
-    std::vector<float> analysisBuffer;
-    std::vector<float> processingBuffer;
-    std::vector<float> hannWindow;
+    // Detection core: collection side runs in processBlock, analysis side on the analysis service
+    PitchDetectionEngine engine;
 
-    std::atomic<int> writePosition{ 0 };
-    std::atomic<int> analysisBufferSize{ 4096 }; // Fixed to match constructor
-    std::atomic<bool> bufferReady{ false };
+    // Lock-free single-producer/single-consumer hand-off to the analysis service
+    static constexpr int numAnalysisSlots = 4;
+    std::array<AnalysisSnapshot, numAnalysisSlots> analysisSlots;
+    std::array<juce::int64, numAnalysisSlots> analysisSubmitTicks{};  // for the queue latency
+    juce::AbstractFifo analysisFifo{ numAnalysisSlots };
+    std::atomic<bool> editorOpen{ false };
 
     // Detected pitch data (thread-safe atomics)
     std::atomic<float> detectedFrequency{ 0.0f };
+    std::atomic<float> detectedConfidence{ 0.0f };
+    std::array<std::atomic<float>, PitchDetectionEngine::maxChannels> channelFrequencies{};
+    std::atomic<int> numAnalysedChannels{ 1 };
     std::atomic<float> centsOffset{ 0.0f };
-    juce::String noteName{ "---" };
-    juce::CriticalSection noteNameLock;
+    SeqLock<NoteDisplay> noteDisplay;
+    SeqLock<PolyphonicFrame> currentVoices;
 
     std::atomic<double> currentSampleRate{ 48000.0 };
 
-    // DC blocker state
-    std::atomic<float> dcBlockerX{ 0.0f };
-    std::atomic<float> dcBlockerY{ 0.0f };
-
-    // Timing for analysis
-    std::atomic<int> samplesUntilNextAnalysis{ 0 };
-    std::atomic<int> currentHopSize{ 4096 };
-
     // Recording state
     std::atomic<bool> recording{ false };
-    std::vector<PitchEvent> pitchLog;
-    juce::CriticalSection pitchLogLock;
-    double recordingStartTime = 0.0;
-    double currentTime = 0.0;
-    int sampleCount = 0;
+    PitchLog pitchLog;  // spills to a temporary file, so memory stays bounded over long takes
+    std::atomic<double> recordingStartTime{ 0.0 };
+    std::atomic<double> currentTime{ 0.0 };
+    std::atomic<double> recordingLength{ 0.0 };
+    std::atomic<double> hostBpm{ 0.0 };
+
+    // Bounded queue from the analysis thread to the message thread (drained into pitchLog)
+    static constexpr int pitchEventQueueSize = 1024;
+    std::vector<PitchEvent> pitchEventQueue;
+    juce::AbstractFifo pitchEventFifo{ pitchEventQueueSize };
+    std::atomic<int> droppedPitchEvents{ 0 };
+    std::atomic<bool> noteTrackingResetPending{ false };
+
+    // Note tracking for MIDI-like behavior, per input channel
+    std::array<std::bitset<128>, PitchDetectionEngine::maxChannels> lastLoggedNotes;
+    std::array<double, PitchDetectionEngine::maxChannels> lastNoteTimes{};
+
+    // Live MIDI queue from the analysis thread to processBlock
+    static constexpr int liveMidiQueueSize = 256;
+    static constexpr int liveMidiChannel = 1;
+    static constexpr float liveMidiHysteresis = 0.2f;  // semitones beyond the half-way point before switching notes
+    static constexpr float liveMidiBendRange = 2.0f;   // semitones
+    std::vector<ScheduledMidi> liveMidiQueue;
+    juce::AbstractFifo liveMidiFifo{ liveMidiQueueSize };
+    int liveMidiNote = -1;       // analysis thread
+    int liveMidiPitchBend = -1;  // analysis thread
+    juce::int64 lastLiveMidiPosition = 0;  // analysis thread: latest position queued so far
+    int outputMidiNote = -1;     // audio thread: note currently held at the plugin's MIDI output
+
+   #if PITCHDETECTOR_INSTRUMENTATION
+    // Written by the audio, analysis and worker threads; reset by prepareToPlay
+    Instrumentation::Counters instrumentation;
+   #endif
+
+    // One pool for every instance in the process; channels (and a long frame's lag blocks) are spread over its idle workers
+    juce::SharedResourcePointer<AnalysisService> analysisService;
+    AnalysisJob analysisJob{ *this };
+    ParallelRunner parallelRunner{ analysisService.get() };
 
-    // Note tracking for MIDI-like behavior
-    int lastMidiNote = -1;
-    double lastNoteTime = 0.0;
+    // Declared last so everything the job touches outlives its registration
+    AnalysisService::Registration analysisRegistration{ analysisService.get(), analysisJob };
 
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PitchDetectorAudioProcessor)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchDetectorAudioProcessor)
 };
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "PolyphonicDetector.h"
+#include "SimdKernels.h"
+#include <cmath>
+
+namespace
+{
+    constexpr float minF0 = 40.0f;
+    constexpr float maxF0 = 2100.0f;
+    constexpr int candidatesPerSemitone = 3;
+    constexpr int numHarmonics = 20;
+    constexpr int mainLobeBins = 4;              // half width of the Blackman-Harris main lobe
+    constexpr float stopBelowRelativeSalience = 0.2f;
+    constexpr float duplicateCents = 60.0f;
+
+    // Harmonic weighting from Klapuri's salience function: favours low partials of low F0s
+    // without letting an octave-up candidate win on the even harmonics alone
+    inline float harmonicWeight(float f0, int harmonic)
+    {
+        return (f0 + 27.0f) / (harmonic * f0 + 320.0f);
+    }
+}
+
+void PolyphonicDetector::prepare(double newSampleRate, int frameLength)
+{
+    sampleRate = newSampleRate;
+    maxPartialFrequency = static_cast<float>(juce::jmin(6000.0, sampleRate * 0.45));
+
+    size_t maxCandidates = 1;
+    for (int order = minOrder; order <= maxOrder; ++order)
+    {
+        auto& r = resolutions[static_cast<size_t>(order - minOrder)];
+        const int size = 1 << order;
+
+        r.fft = std::make_unique<juce::dsp::FFT>(order);
+
+        // 4-term Blackman-Harris: sidelobes low enough that weak chord tones are not buried in leakage
+        r.window.resize(size);
+        for (int i = 0; i < size; ++i)
+        {
+            const double phase = juce::MathConstants<double>::twoPi * i / (size - 1);
+            r.window[i] = static_cast<float>(0.35875 - 0.48829 * std::cos(phase) + 0.14128 * std::cos(2.0 * phase) - 0.01168 * std::cos(3.0 * phase));
+        }
+
+        // The lowest candidates need at least two bins between partials to be resolvable
+        const float lowest = juce::jmax(minF0, 2.0f * static_cast<float>(sampleRate / size));
+        const float highest = juce::jmin(maxF0, maxPartialFrequency);
+        const int numCandidates = juce::jmax(1, static_cast<int>(std::log2(highest / lowest) * 12.0f * candidatesPerSemitone) + 1);
+
+        r.candidates.resize(numCandidates);
+        for (int c = 0; c < numCandidates; ++c)
+            r.candidates[c] = lowest * std::pow(2.0f, c / (12.0f * candidatesPerSemitone));
+
+        maxCandidates = juce::jmax(maxCandidates, r.candidates.size());
+    }
+
+    fftData.assign(static_cast<size_t>(2) << maxOrder, 0.0f);
+    residual.assign((static_cast<size_t>(1) << maxOrder) / 2 + 1, 0.0f);
+    partials.assign(numHarmonics + 1, Partial{});
+    candidateSalience.assign(maxCandidates, 0.0f);
+
+    setFrameLength(frameLength);
+}
+
+void PolyphonicDetector::setFrameLength(int frameLength)
+{
+    // Largest power of two that fits the analysis buffer, within 2048..16384
+    int order = minOrder;
+    while (order < maxOrder && (1 << (order + 1)) <= frameLength)
+        ++order;
+
+    resolution = &resolutions[static_cast<size_t>(order - minOrder)];
+    fftSize = 1 << order;
+    numBins = fftSize / 2 + 1;
+    binWidth = static_cast<float>(sampleRate / fftSize);
+}
+
+PolyphonicDetector::Partial PolyphonicDetector::findPartial(float frequency) const
+{
+    // Strongest residual bin within ~17 cents (at least one bin) of the expected partial
+    const float centre = frequency / binWidth;
+    const float tolerance = juce::jmax(1.0f, centre * 0.01f);
+    const int lo = juce::jmax(1, static_cast<int>(std::floor(centre - tolerance)));
+    const int hi = juce::jmin(numBins - 2, static_cast<int>(std::ceil(centre + tolerance)));
+
+    Partial partial;
+    for (int k = lo; k <= hi; ++k)
+    {
+        if (residual[k] > partial.amplitude)
+        {
+            partial.amplitude = residual[k];
+            partial.bin = k;
+        }
+    }
+
+    return partial;
+}
+
+float PolyphonicDetector::salienceOf(float f0) const
+{
+    float salience = 0.0f;
+
+    for (int h = 1; h <= numHarmonics && h * f0 < maxPartialFrequency; ++h)
+        salience += harmonicWeight(f0, h) * findPartial(h * f0).amplitude;
+
+    return salience;
+}
+
+float PolyphonicDetector::refineFrequency(float f0) const
+{
+    // Amplitude-weighted mean of the first few partials' interpolated peaks, each divided by its number
+    double weightedSum = 0.0;
+    double totalWeight = 0.0;
+
+    for (int h = 1; h <= 5 && h * f0 < maxPartialFrequency; ++h)
+    {
+        const auto partial = findPartial(h * f0);
+        if (partial.bin < 1)
+            continue;
+
+        const float s0 = std::log(residual[partial.bin - 1] + 1.0e-9f);
+        const float s1 = std::log(residual[partial.bin] + 1.0e-9f);
+        const float s2 = std::log(residual[partial.bin + 1] + 1.0e-9f);
+        const float denom = s0 - 2.0f * s1 + s2;
+        const float offset = std::abs(denom) > 1.0e-6f ? juce::jlimit(-0.5f, 0.5f, 0.5f * (s0 - s2) / denom) : 0.0f;
+
+        weightedSum += partial.amplitude * (partial.bin + offset) * binWidth / h;
+        totalWeight += partial.amplitude;
+    }
+
+    if (totalWeight <= 0.0)
+        return f0;
+
+    // Keep the grid estimate if the partials point somewhere else entirely
+    const auto refined = static_cast<float>(weightedSum / totalWeight);
+    return std::abs(1200.0f * std::log2(refined / f0)) < 100.0f / candidatesPerSemitone ? refined : f0;
+}
+
+void PolyphonicDetector::cancel(float f0)
+{
+    int numPartials = 0;
+    for (int h = 1; h <= numHarmonics && h * f0 < maxPartialFrequency; ++h)
+        partials[numPartials++] = findPartial(h * f0);
+
+    for (int i = 0; i < numPartials; ++i)
+    {
+        const auto& partial = partials[i];
+        if (partial.bin < 0 || partial.amplitude <= 0.0f)
+            continue;
+
+        // Spectral smoothness: only remove the part of the peak its neighbours account for
+        float sum = partial.amplitude;
+        int count = 1;
+        if (i > 0)               { sum += partials[i - 1].amplitude; ++count; }
+        if (i + 1 < numPartials) { sum += partials[i + 1].amplitude; ++count; }
+
+        const float removed = juce::jmin(partial.amplitude, sum / count);
+        const float keep = 1.0f - removed / partial.amplitude;
+
+        const int lo = juce::jmax(0, partial.bin - mainLobeBins);
+        const int hi = juce::jmin(numBins - 1, partial.bin + mainLobeBins);
+        for (int k = lo; k <= hi; ++k)
+            residual[k] *= keep;
+    }
+}
+
+void PolyphonicDetector::detect(const float* samples, int numSamples, PolyphonicFrame& frame)
+{
+    frame.numVoices = 0;
+
+    const int length = juce::jmin(numSamples, fftSize);
+    const float* newest = samples + (numSamples - length);
+
+    if (length <= 0 || std::sqrt(SimdKernels::sumOfSquares(newest, length) / length) < 0.01f)
+        return;
+
+    std::fill(fftData.begin(), fftData.begin() + fftSize * 2, 0.0f);
+    SimdKernels::multiply(fftData.data(), newest, resolution->window.data() + (fftSize - length), length);
+    resolution->fft->performFrequencyOnlyForwardTransform(fftData.data(), true);
+    std::copy(fftData.begin(), fftData.begin() + numBins, residual.begin());
+
+    const auto& candidates = resolution->candidates;
+    const int numCandidates = static_cast<int>(candidates.size());
+    float strongest = 0.0f;
+
+    // A couple of spare rounds so rejected duplicates do not cost a voice
+    for (int round = 0; round < maxVoices + 2 && frame.numVoices < maxVoices; ++round)
+    {
+        int best = -1;
+        float bestSalience = 0.0f;
+
+        for (int c = 0; c < numCandidates; ++c)
+        {
+            candidateSalience[c] = salienceOf(candidates[c]);
+            if (candidateSalience[c] > bestSalience)
+            {
+                bestSalience = candidateSalience[c];
+                best = c;
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        if (round == 0)
+            strongest = bestSalience;
+        else if (bestSalience < strongest * stopBelowRelativeSalience)
+            break;
+
+        // Parabolic peak between neighbouring candidates, then refine from the partials
+        float f0 = candidates[best];
+        if (best > 0 && best < numCandidates - 1)
+        {
+            const float s0 = candidateSalience[best - 1];
+            const float s2 = candidateSalience[best + 1];
+            const float denom = s0 - 2.0f * bestSalience + s2;
+            if (std::abs(denom) > 1.0e-9f)
+                f0 *= std::pow(2.0f, juce::jlimit(-0.5f, 0.5f, 0.5f * (s0 - s2) / denom) / (12.0f * candidatesPerSemitone));
+        }
+
+        f0 = refineFrequency(f0);
+        cancel(f0);
+
+        bool duplicate = false;
+        for (int v = 0; v < frame.numVoices; ++v)
+            duplicate = duplicate || std::abs(1200.0f * std::log2(f0 / frame.frequency[v])) < duplicateCents;
+
+        if (duplicate)
+            continue;
+
+        frame.frequency[frame.numVoices] = f0;
+        frame.salience[frame.numVoices] = bestSalience / strongest;
+        ++frame.numVoices;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// One analysis frame's worth of simultaneous pitches, strongest first
+// Fixed capacity and trivially copyable so it can be published through a SeqLock.
+struct PolyphonicFrame
+{
+    static constexpr int maxVoices = 6;
+
+    double timeInSeconds = 0.0;
+    int numVoices = 0;
+    float frequency[maxVoices] = {};
+    float salience[maxVoices] = {};  // relative to the strongest voice (1.0)
+};
+
+// Multiple-F0 estimation by iterative estimation and cancellation
+//
+// A windowed FFT of the newest frame gives the magnitude spectrum. Each round scores a fixed
+// log-spaced grid of F0 candidates by weighted harmonic summation, takes the strongest, refines it
+// from its partials' interpolated peaks and then removes those partials from the residual
+// spectrum. Partials are only removed down to the level of their neighbours (spectral smoothness),
+// so a partial shared with another note keeps that note's share. Work per frame is bounded by
+// candidates x harmonics x maxVoices, and nothing allocates after prepare(): the FFT, window and
+// candidate grid for every supported frame length are built there, and setFrameLength() picks one.
+class PolyphonicDetector
+{
+public:
+    void prepare(double sampleRate, int frameLength);
+    void setFrameLength(int frameLength);
+
+    // samples holds numSamples input samples, oldest to newest; the newest FFT-size block is used
+    void detect(const float* samples, int numSamples, PolyphonicFrame& frame);
+
+    void setMaxVoices(int newMaxVoices) { maxVoices = juce::jlimit(1, PolyphonicFrame::maxVoices, newMaxVoices); }
+
+private:
+    struct Partial
+    {
+        int bin = -1;
+        float amplitude = 0.0f;
+    };
+
+    // Everything that depends on the FFT size
+    struct Resolution
+    {
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<float> window;
+        std::vector<float> candidates;
+    };
+
+    static constexpr int minOrder = 11;
+    static constexpr int maxOrder = 14;
+
+    float salienceOf(float f0) const;
+    Partial findPartial(float frequency) const;
+    float refineFrequency(float f0) const;
+    void cancel(float f0);
+
+    double sampleRate = 48000.0;
+    int fftSize = 0;
+    int numBins = 0;
+    float binWidth = 1.0f;
+    float maxPartialFrequency = 6000.0f;
+    int maxVoices = 4;
+
+    std::array<Resolution, maxOrder - minOrder + 1> resolutions;
+    const Resolution* resolution = nullptr;  // the one matching fftSize
+    std::vector<float> fftData;
+    std::vector<float> residual;
+    std::vector<float> candidateSalience;
+    std::vector<Partial> partials;
+};
\ No newline at end of file
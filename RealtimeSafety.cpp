@@ -0,0 +1,32 @@
+#include "RealtimeSafety.h"
+
+namespace RealtimeSafety
+{
+    namespace
+    {
+        thread_local int realtimeDepth = 0;
+        std::atomic<int> violationCount{ 0 };
+    }
+
+    ScopedRealtimeSection::ScopedRealtimeSection() noexcept { ++realtimeDepth; }
+    ScopedRealtimeSection::~ScopedRealtimeSection() noexcept { --realtimeDepth; }
+
+    bool isInRealtimeSection() noexcept
+    {
+       #if PITCHDETECTOR_CHECK_REALTIME
+        return realtimeDepth > 0;
+       #else
+        return false;
+       #endif
+    }
+
+    void reportViolation() noexcept
+    {
+        violationCount.fetch_add(1, std::memory_order_relaxed);
+
+        // Something locked inside processBlock
+        jassertfalse;
+    }
+
+    int getViolationCount() noexcept { return violationCount.load(std::memory_order_relaxed); }
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <type_traits>
+
+// Real-time safety helpers shared by the processor
+//
+// PITCHDETECTOR_CHECK_REALTIME enables the debug guard: code running inside a
+// ScopedRealtimeSection (processBlock) that takes a CheckedScopedLock bumps a
+// violation counter and hits a jassert. Heap use on the collection side is
+// checked by the Benchmarks tool, which can replace the allocator safely.
+#ifndef PITCHDETECTOR_CHECK_REALTIME
+ #define PITCHDETECTOR_CHECK_REALTIME JUCE_DEBUG
+#endif
+
+namespace RealtimeSafety
+{
+    // Marks the current thread as real-time for the lifetime of the object
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept;
+        ~ScopedRealtimeSection() noexcept;
+    };
+
+    bool isInRealtimeSection() noexcept;
+    void reportViolation() noexcept;
+    int getViolationCount() noexcept;
+
+    // juce::ScopedLock that reports itself when taken on a real-time thread
+    struct CheckedScopedLock
+    {
+        explicit CheckedScopedLock(const juce::CriticalSection& cs) noexcept : lock((checkNotRealtime(), cs)) {}
+
+    private:
+        static void checkNotRealtime() noexcept
+        {
+            if (isInRealtimeSection())
+                reportViolation();
+        }
+
+        juce::ScopedLock lock;
+    };
+}
+
+// Single-writer sequence lock for small trivially copyable values
+// The writer never blocks; readers retry if they raced with a write.
+// The payload is stored as relaxed atomic words so torn reads are detected rather than undefined.
+template <typename T>
+class SeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+    SeqLock() { store(T{}); }
+
+    void store(const T& value) noexcept
+    {
+        std::uint64_t words[numWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+
+        const auto seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i = 0; i < numWords; ++i)
+            data[i].store(words[i], std::memory_order_relaxed);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const noexcept
+    {
+        std::uint64_t words[numWords];
+
+        for (;;)
+        {
+            const auto before = sequence.load(std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+                continue;
+
+            for (int i = 0; i < numWords; ++i)
+                words[i] = data[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        T result;
+        std::memcpy(&result, words, sizeof(T));
+        return result;
+    }
+
+private:
+    static constexpr int numWords = static_cast<int>((sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+
+    std::atomic<std::uint32_t> sequence{ 0 };
+    std::atomic<std::uint64_t> data[numWords];
+};
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "SimdKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if defined(__GNUC__) || defined(__clang__)
+  #define PITCHDETECTOR_TARGET_AVX2 __attribute__((target("avx2")))
+ #else
+  #define PITCHDETECTOR_TARGET_AVX2
+ #endif
+#endif
+
+#if JUCE_ARM && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define PITCHDETECTOR_HAS_NEON 1
+#else
+ #define PITCHDETECTOR_HAS_NEON 0
+#endif
+
+namespace SimdKernels
+{
+namespace
+{
+    //==============================================================================
+    namespace scalar
+    {
+        void multiply(float* dest, const float* a, const float* b, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = a[i] * b[i];
+        }
+
+        float sum(const float* x, int numSamples)
+        {
+            float total = 0.0f;
+            for (int i = 0; i < numSamples; ++i)
+                total += x[i];
+            return total;
+        }
+
+        float sumOfSquares(const float* x, int numSamples)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < numSamples; ++i)
+                sum += x[i] * x[i];
+            return sum;
+        }
+
+        float sumOfSquaredDifferences(const float* a, const float* b, int numSamples)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float delta = a[i] - b[i];
+                sum += delta * delta;
+            }
+            return sum;
+        }
+
+        void dcBlock(const float* input, float* output, int numSamples, float coefficient, float& x1, float& y1)
+        {
+            float x = x1;
+            float y = y1;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float in = input[i];
+                const float out = in - x + coefficient * y;
+                x = in;
+                y = out;
+                output[i] = out;
+            }
+
+            x1 = x;
+            y1 = y;
+        }
+
+        // Shared tail for the vector versions, which hand over their running sum
+        void cumulativeMeanNormaliseFrom(float* diff, int start, int numLags, float runningSum)
+        {
+            for (int tau = start; tau < numLags; ++tau)
+            {
+                runningSum += diff[tau];
+                if (runningSum > 0.0f)
+                    diff[tau] *= static_cast<float>(tau) / runningSum;
+                else
+                    diff[tau] = 1.0f;
+            }
+        }
+
+    }
+
+   #if JUCE_INTEL
+    //==============================================================================
+    namespace sse2
+    {
+        inline float horizontalSum(__m128 v)
+        {
+            __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 sums = _mm_add_ps(v, shuffled);
+            shuffled = _mm_movehl_ps(shuffled, sums);
+            sums = _mm_add_ss(sums, shuffled);
+            return _mm_cvtss_f32(sums);
+        }
+
+        inline float lastLane(__m128 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+        // [v0 v1 v2 v3] -> [0 v0 v1 v2] and [0 0 v0 v1]
+        inline __m128 shiftUp1(__m128 v) { return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)); }
+        inline __m128 shiftUp2(__m128 v) { return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)); }
+
+        void multiply(float* dest, const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+                _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+            scalar::multiply(dest + i, a + i, b + i, numSamples - i);
+        }
+
+        float sum(const float* x, int numSamples)
+        {
+            __m128 acc = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+                acc = _mm_add_ps(acc, _mm_loadu_ps(x + i));
+
+            return horizontalSum(acc) + scalar::sum(x + i, numSamples - i);
+        }
+
+        float sumOfSquares(const float* x, int numSamples)
+        {
+            __m128 acc = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const __m128 v = _mm_loadu_ps(x + i);
+                acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+            }
+
+            return horizontalSum(acc) + scalar::sumOfSquares(x + i, numSamples - i);
+        }
+
+        float sumOfSquaredDifferences(const float* a, const float* b, int numSamples)
+        {
+            __m128 acc = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const __m128 delta = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+                acc = _mm_add_ps(acc, _mm_mul_ps(delta, delta));
+            }
+
+            return horizontalSum(acc) + scalar::sumOfSquaredDifferences(a + i, b + i, numSamples - i);
+        }
+
+        void dcBlock(const float* input, float* output, int numSamples, float coefficient, float& x1, float& y1)
+        {
+            // The recursion is resolved four samples at a time with an in-register prefix scan:
+            // y[k] = sum_{i<=k} c^(k-i) d[i] + c^(k+1) y[-1], where d[i] = x[i] - x[i-1]
+            const float c2 = coefficient * coefficient;
+            const __m128 a1 = _mm_set1_ps(coefficient);
+            const __m128 a2 = _mm_set1_ps(c2);
+            const __m128 carryWeights = _mm_setr_ps(coefficient, c2, c2 * coefficient, c2 * c2);
+
+            float x = x1;
+            float y = y1;
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const __m128 current = _mm_loadu_ps(input + i);
+                const __m128 previous = _mm_move_ss(shiftUp1(current), _mm_set_ss(x));
+                x = input[i + 3];
+
+                __m128 v = _mm_sub_ps(current, previous);
+                v = _mm_add_ps(v, _mm_mul_ps(a1, shiftUp1(v)));
+                v = _mm_add_ps(v, _mm_mul_ps(a2, shiftUp2(v)));
+                v = _mm_add_ps(v, _mm_mul_ps(carryWeights, _mm_set1_ps(y)));
+
+                _mm_storeu_ps(output + i, v);
+                y = lastLane(v);
+            }
+
+            x1 = x;
+            y1 = y;
+            scalar::dcBlock(input + i, output + i, numSamples - i, coefficient, x1, y1);
+        }
+
+        void cumulativeMeanNormaliseFrom(float* diff, int start, int numLags, float runningSum)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 four = _mm_set1_ps(4.0f);
+            const float first = static_cast<float>(start);
+            __m128 tauVec = _mm_setr_ps(first, first + 1.0f, first + 2.0f, first + 3.0f);
+            int tau = start;
+
+            for (; tau + 4 <= numLags; tau += 4)
+            {
+                const __m128 d = _mm_loadu_ps(diff + tau);
+
+                // Prefix sum of the four lanes plus the carry from earlier lags
+                __m128 prefix = _mm_add_ps(d, shiftUp1(d));
+                prefix = _mm_add_ps(prefix, shiftUp2(prefix));
+                prefix = _mm_add_ps(prefix, _mm_set1_ps(runningSum));
+
+                const __m128 normalised = _mm_mul_ps(d, _mm_div_ps(tauVec, prefix));
+                const __m128 positive = _mm_cmpgt_ps(prefix, zero);
+                _mm_storeu_ps(diff + tau, _mm_or_ps(_mm_and_ps(positive, normalised), _mm_andnot_ps(positive, one)));
+
+                runningSum = lastLane(prefix);
+                tauVec = _mm_add_ps(tauVec, four);
+            }
+
+            scalar::cumulativeMeanNormaliseFrom(diff, tau, numLags, runningSum);
+        }
+    }
+
+    //==============================================================================
+    // The recursive kernels (DC blocker, CMND scan) gain nothing from 8 lanes that cross
+    // 128-bit halves, so the AVX2 table reuses the SSE2 versions for those
+    namespace avx2
+    {
+        PITCHDETECTOR_TARGET_AVX2 inline float horizontalSum(__m256 v)
+        {
+            return sse2::horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+        }
+
+        PITCHDETECTOR_TARGET_AVX2 void multiply(float* dest, const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+                _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+
+            scalar::multiply(dest + i, a + i, b + i, numSamples - i);
+        }
+
+        PITCHDETECTOR_TARGET_AVX2 float sum(const float* x, int numSamples)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+                acc = _mm256_add_ps(acc, _mm256_loadu_ps(x + i));
+
+            return horizontalSum(acc) + scalar::sum(x + i, numSamples - i);
+        }
+
+        PITCHDETECTOR_TARGET_AVX2 float sumOfSquares(const float* x, int numSamples)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const __m256 v = _mm256_loadu_ps(x + i);
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(v, v));
+            }
+
+            return horizontalSum(acc) + scalar::sumOfSquares(x + i, numSamples - i);
+        }
+
+        PITCHDETECTOR_TARGET_AVX2 float sumOfSquaredDifferences(const float* a, const float* b, int numSamples)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(delta, delta));
+            }
+
+            return horizontalSum(acc) + scalar::sumOfSquaredDifferences(a + i, b + i, numSamples - i);
+        }
+    }
+   #endif
+
+   #if PITCHDETECTOR_HAS_NEON
+    //==============================================================================
+    namespace neon
+    {
+        inline float lastLane(float32x4_t v) { return vgetq_lane_f32(v, 3); }
+        inline float32x4_t shiftUp1(float32x4_t v) { return vextq_f32(vdupq_n_f32(0.0f), v, 3); }
+        inline float32x4_t shiftUp2(float32x4_t v) { return vextq_f32(vdupq_n_f32(0.0f), v, 2); }
+
+        void multiply(float* dest, const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+                vst1q_f32(dest + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+
+            scalar::multiply(dest + i, a + i, b + i, numSamples - i);
+        }
+
+        float sum(const float* x, int numSamples)
+        {
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+                acc = vaddq_f32(acc, vld1q_f32(x + i));
+
+            return vaddvq_f32(acc) + scalar::sum(x + i, numSamples - i);
+        }
+
+        float sumOfSquares(const float* x, int numSamples)
+        {
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const float32x4_t v = vld1q_f32(x + i);
+                acc = vaddq_f32(acc, vmulq_f32(v, v));
+            }
+
+            return vaddvq_f32(acc) + scalar::sumOfSquares(x + i, numSamples - i);
+        }
+
+        float sumOfSquaredDifferences(const float* a, const float* b, int numSamples)
+        {
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const float32x4_t delta = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+                acc = vaddq_f32(acc, vmulq_f32(delta, delta));
+            }
+
+            return vaddvq_f32(acc) + scalar::sumOfSquaredDifferences(a + i, b + i, numSamples - i);
+        }
+
+        void dcBlock(const float* input, float* output, int numSamples, float coefficient, float& x1, float& y1)
+        {
+            const float c2 = coefficient * coefficient;
+            const float32x4_t a1 = vdupq_n_f32(coefficient);
+            const float32x4_t a2 = vdupq_n_f32(c2);
+            const float carryValues[4] = { coefficient, c2, c2 * coefficient, c2 * c2 };
+            const float32x4_t carryWeights = vld1q_f32(carryValues);
+
+            float x = x1;
+            float y = y1;
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const float32x4_t current = vld1q_f32(input + i);
+                const float32x4_t previous = vextq_f32(vdupq_n_f32(x), current, 3);
+                x = input[i + 3];
+
+                float32x4_t v = vsubq_f32(current, previous);
+                v = vaddq_f32(v, vmulq_f32(a1, shiftUp1(v)));
+                v = vaddq_f32(v, vmulq_f32(a2, shiftUp2(v)));
+                v = vaddq_f32(v, vmulq_f32(carryWeights, vdupq_n_f32(y)));
+
+                vst1q_f32(output + i, v);
+                y = lastLane(v);
+            }
+
+            x1 = x;
+            y1 = y;
+            scalar::dcBlock(input + i, output + i, numSamples - i, coefficient, x1, y1);
+        }
+
+        void cumulativeMeanNormaliseFrom(float* diff, int start, int numLags, float runningSum)
+        {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            const float32x4_t one = vdupq_n_f32(1.0f);
+            const float32x4_t four = vdupq_n_f32(4.0f);
+            const float first = static_cast<float>(start);
+            const float initialTau[4] = { first, first + 1.0f, first + 2.0f, first + 3.0f };
+            float32x4_t tauVec = vld1q_f32(initialTau);
+            int tau = start;
+
+            for (; tau + 4 <= numLags; tau += 4)
+            {
+                const float32x4_t d = vld1q_f32(diff + tau);
+
+                float32x4_t prefix = vaddq_f32(d, shiftUp1(d));
+                prefix = vaddq_f32(prefix, shiftUp2(prefix));
+                prefix = vaddq_f32(prefix, vdupq_n_f32(runningSum));
+
+                const float32x4_t normalised = vmulq_f32(d, vdivq_f32(tauVec, prefix));
+                vst1q_f32(diff + tau, vbslq_f32(vcgtq_f32(prefix, zero), normalised, one));
+
+                runningSum = lastLane(prefix);
+                tauVec = vaddq_f32(tauVec, four);
+            }
+
+            scalar::cumulativeMeanNormaliseFrom(diff, tau, numLags, runningSum);
+        }
+    }
+   #endif
+
+    //==============================================================================
+    struct KernelTable
+    {
+        void (*multiply)(float*, const float*, const float*, int);
+        float (*sum)(const float*, int);
+        float (*sumOfSquares)(const float*, int);
+        float (*sumOfSquaredDifferences)(const float*, const float*, int);
+        void (*dcBlock)(const float*, float*, int, float, float&, float&);
+        void (*cumulativeMeanNormaliseFrom)(float*, int, int, float);
+    };
+
+    const KernelTable scalarKernels{ scalar::multiply, scalar::sum, scalar::sumOfSquares, scalar::sumOfSquaredDifferences,
+                                     scalar::dcBlock, scalar::cumulativeMeanNormaliseFrom };
+
+   #if JUCE_INTEL
+    const KernelTable sse2Kernels{ sse2::multiply, sse2::sum, sse2::sumOfSquares, sse2::sumOfSquaredDifferences,
+                                   sse2::dcBlock, sse2::cumulativeMeanNormaliseFrom };
+
+    const KernelTable avx2Kernels{ avx2::multiply, avx2::sum, avx2::sumOfSquares, avx2::sumOfSquaredDifferences,
+                                   sse2::dcBlock, sse2::cumulativeMeanNormaliseFrom };
+   #endif
+
+   #if PITCHDETECTOR_HAS_NEON
+    const KernelTable neonKernels{ neon::multiply, neon::sum, neon::sumOfSquares, neon::sumOfSquaredDifferences,
+                                   neon::dcBlock, neon::cumulativeMeanNormaliseFrom };
+   #endif
+
+    bool isSupported(InstructionSet set)
+    {
+        switch (set)
+        {
+           #if JUCE_INTEL
+            case InstructionSet::sse2: return true;
+            case InstructionSet::avx2: return juce::SystemStats::hasAVX2();
+           #endif
+           #if PITCHDETECTOR_HAS_NEON
+            case InstructionSet::neon: return true;
+           #endif
+            case InstructionSet::scalar: return true;
+            default: return false;
+        }
+    }
+
+    const KernelTable& tableFor(InstructionSet set)
+    {
+        switch (set)
+        {
+           #if JUCE_INTEL
+            case InstructionSet::sse2: return sse2Kernels;
+            case InstructionSet::avx2: return avx2Kernels;
+           #endif
+           #if PITCHDETECTOR_HAS_NEON
+            case InstructionSet::neon: return neonKernels;
+           #endif
+            default: return scalarKernels;
+        }
+    }
+
+    std::atomic<const KernelTable*> activeKernels{ nullptr };
+    std::atomic<InstructionSet> activeInstructionSet{ InstructionSet::scalar };
+
+    const KernelTable& kernels()
+    {
+        if (auto* table = activeKernels.load(std::memory_order_acquire))
+            return *table;
+
+        setInstructionSet(getBestAvailableInstructionSet());
+        return *activeKernels.load(std::memory_order_acquire);
+    }
+}
+
+//==============================================================================
+InstructionSet getBestAvailableInstructionSet()
+{
+   #if JUCE_INTEL
+    return juce::SystemStats::hasAVX2() ? InstructionSet::avx2 : InstructionSet::sse2;
+   #elif PITCHDETECTOR_HAS_NEON
+    return InstructionSet::neon;
+   #else
+    return InstructionSet::scalar;
+   #endif
+}
+
+InstructionSet getInstructionSet()
+{
+    kernels();
+    return activeInstructionSet.load(std::memory_order_relaxed);
+}
+
+const char* getInstructionSetName(InstructionSet set)
+{
+    switch (set)
+    {
+        case InstructionSet::sse2: return "SSE2";
+        case InstructionSet::avx2: return "AVX2";
+        case InstructionSet::neon: return "NEON";
+        default: return "Scalar";
+    }
+}
+
+void setInstructionSet(InstructionSet set)
+{
+    if (!isSupported(set))
+        set = getBestAvailableInstructionSet();
+
+    activeInstructionSet.store(set, std::memory_order_relaxed);
+    activeKernels.store(&tableFor(set), std::memory_order_release);
+}
+
+void multiply(float* dest, const float* a, const float* b, int numSamples) { kernels().multiply(dest, a, b, numSamples); }
+float sum(const float* x, int numSamples) { return kernels().sum(x, numSamples); }
+float sumOfSquares(const float* x, int numSamples) { return kernels().sumOfSquares(x, numSamples); }
+float sumOfSquaredDifferences(const float* a, const float* b, int numSamples) { return kernels().sumOfSquaredDifferences(a, b, numSamples); }
+void dcBlock(const float* input, float* output, int numSamples, float coefficient, float& x1, float& y1) { kernels().dcBlock(input, output, numSamples, coefficient, x1, y1); }
+void cumulativeMeanNormalise(float* diff, int startLag, int numLags, float runningSum) { kernels().cumulativeMeanNormaliseFrom(diff, startLag, numLags, runningSum); }
+
+void cumulativeMeanNormalise(float* diff, int numLags)
+{
+    if (numLags <= 0)
+        return;
+
+    diff[0] = 0.0f;
+    cumulativeMeanNormalise(diff, 1, numLags, 0.0f);
+}
+
+bool runSelfTest()
+{
+    constexpr int length = 1037; // deliberately not a multiple of any vector width
+    std::vector<float> a(length), b(length), expected(length), actual(length);
+
+    juce::Random random(1234);
+    for (int i = 0; i < length; ++i)
+    {
+        a[i] = random.nextFloat() * 2.0f - 1.0f;
+        b[i] = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+    auto close = [](float x, float y, float tolerance) { return std::abs(x - y) <= tolerance * juce::jmax(1.0f, std::abs(x)); };
+
+    const InstructionSet sets[] = { InstructionSet::sse2, InstructionSet::avx2, InstructionSet::neon };
+    bool ok = true;
+
+    for (auto set : sets)
+    {
+        if (!isSupported(set))
+            continue;
+
+        const auto& simd = tableFor(set);
+
+        scalarKernels.multiply(expected.data(), a.data(), b.data(), length);
+        simd.multiply(actual.data(), a.data(), b.data(), length);
+        ok = ok && expected == actual;
+
+        ok = ok && close(scalarKernels.sum(a.data(), length), simd.sum(a.data(), length), 1.0e-4f);
+        ok = ok && close(scalarKernels.sumOfSquares(a.data(), length), simd.sumOfSquares(a.data(), length), 1.0e-5f);
+        ok = ok && close(scalarKernels.sumOfSquaredDifferences(a.data(), b.data(), length),
+                         simd.sumOfSquaredDifferences(a.data(), b.data(), length), 1.0e-5f);
+
+        float ex = 0.1f, ey = -0.2f, ax = 0.1f, ay = -0.2f;
+        scalarKernels.dcBlock(a.data(), expected.data(), length, 0.99f, ex, ey);
+        simd.dcBlock(a.data(), actual.data(), length, 0.99f, ax, ay);
+        for (int i = 0; i < length; ++i)
+            ok = ok && close(expected[i], actual[i], 1.0e-4f);
+
+        // From lag 1 with nothing carried, then resuming part way through with a carried sum
+        for (const int start : { 1, 517 })
+        {
+            for (int i = 0; i < length; ++i)
+                expected[i] = actual[i] = a[i] * a[i];
+
+            const float carried = start == 1 ? 0.0f : 3.5f;
+            scalarKernels.cumulativeMeanNormaliseFrom(expected.data(), start, length, carried);
+            simd.cumulativeMeanNormaliseFrom(actual.data(), start, length, carried);
+
+            for (int i = start; i < length; ++i)
+                ok = ok && close(expected[i], actual[i], 1.0e-4f);
+        }
+    }
+
+    return ok;
+}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Vectorised inner loops for the detection pipeline
+//
+// Each kernel has a scalar reference plus SSE2, AVX2 and NEON versions; the widest one the CPU
+// supports is picked once at runtime. Reductions are summed in lane order rather than strictly
+// left to right, so results match the scalar kernels to within float rounding, not bit for bit
+// (multiply is exact).
+//
+// Written with raw intrinsics rather than juce::dsp::SIMDRegister, which is fixed to the compile-time
+// target (no runtime AVX2 dispatch) and has no lane shifts: the DC blocker and the CMND running sum
+// are resolved as in-register prefix scans, which shift lanes up by one and two. Run runSelfTest()
+// via the benchmark tool's --selftest after changing any of them.
+namespace SimdKernels
+{
+    enum class InstructionSet { scalar, sse2, avx2, neon };
+
+    InstructionSet getInstructionSet();
+    InstructionSet getBestAvailableInstructionSet();
+    const char* getInstructionSetName(InstructionSet set);
+
+    // Overrides the runtime choice, e.g. to A/B against the scalar path; falls back if unsupported
+    void setInstructionSet(InstructionSet set);
+
+    // dest[i] = a[i] * b[i]
+    void multiply(float* dest, const float* a, const float* b, int numSamples);
+
+    // sum x[i]
+    float sum(const float* x, int numSamples);
+
+    // sum x[i]^2
+    float sumOfSquares(const float* x, int numSamples);
+
+    // sum (a[i] - b[i])^2
+    float sumOfSquaredDifferences(const float* a, const float* b, int numSamples);
+
+    // One-pole DC blocker: y[n] = x[n] - x[n-1] + coefficient * y[n-1]; x1/y1 carry the state
+    void dcBlock(const float* input, float* output, int numSamples, float coefficient, float& x1, float& y1);
+
+    // YIN cumulative mean normalisation of diff[1..numLags), diff[0] is set to 0
+    void cumulativeMeanNormalise(float* diff, int numLags);
+
+    // The same from startLag on, continuing from runningSum (the sum of diff[1..startLag) before normalising)
+    void cumulativeMeanNormalise(float* diff, int startLag, int numLags, float runningSum);
+
+    // Cross-checks every available instruction set against the scalar kernels on random data
+    bool runSelfTest();
+}
\ No newline at end of file
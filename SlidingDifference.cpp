@@ -0,0 +1,109 @@
+#include "SlidingDifference.h"
+#include "SimdKernels.h"
+
+void SlidingDifference::prepare(int maxLags, int newWindowLength, int historyLength)
+{
+    lagCapacity = juce::jmax(2, maxLags);
+
+    blockSums.assign(static_cast<size_t>(maxBlocks) * lagCapacity, 0.0f);
+    blockLengths.assign(maxBlocks, 0);
+    difference.assign(lagCapacity, 0.0f);
+
+    configure(lagCapacity, newWindowLength, historyLength);
+}
+
+void SlidingDifference::configure(int newNumLags, int newWindowLength, int historyLength)
+{
+    numLags = juce::jlimit(2, lagCapacity, newNumLags);
+    windowLength = juce::jmax(1, juce::jmin(newWindowLength, historyLength - numLags));
+
+    // When the history has to be rebuilt, split it so it ages out gradually instead of all at once
+    resetBlockLength = juce::jmax(1, windowLength / 8);
+
+    reset();
+}
+
+void SlidingDifference::reset()
+{
+    firstBlock = 0;
+    numBlocks = 0;
+    coveredLength = 0;
+    lastEndPosition = -1;
+    std::fill(difference.begin(), difference.end(), 0.0f);
+}
+
+void SlidingDifference::update(const float* samples, int numSamples, juce::int64 endPosition)
+{
+    // Oldest sample index whose lag partners are all inside the supplied history
+    const int earliestUsable = numLags;
+
+    if (numSamples <= earliestUsable)
+        return;
+
+    const juce::int64 numNew = endPosition - lastEndPosition;
+
+    if (lastEndPosition < 0 || numNew <= 0 || numNew > numSamples - earliestUsable)
+    {
+        // First frame, a jump in the stream, or frames were skipped: rebuild from the history we have
+        reset();
+
+        const int start = juce::jmax(earliestUsable, numSamples - windowLength);
+        for (int blockStart = start; blockStart < numSamples; blockStart += resetBlockLength)
+            addBlock(samples, blockStart, juce::jmin(resetBlockLength, numSamples - blockStart));
+    }
+    else
+    {
+        addBlock(samples, numSamples - static_cast<int>(numNew), static_cast<int>(numNew));
+    }
+
+    lastEndPosition = endPosition;
+    dropExpiredBlocks();
+    sumBlocks();
+}
+
+void SlidingDifference::addBlock(const float* samples, int startIndex, int length)
+{
+    if (numBlocks == maxBlocks)
+    {
+        // Ring is full - the oldest block is beyond any realistic window, retire it
+        coveredLength -= blockLengths[firstBlock];
+        firstBlock = (firstBlock + 1) % maxBlocks;
+        --numBlocks;
+    }
+
+    const int slot = (firstBlock + numBlocks) % maxBlocks;
+    float* sums = blockSums.data() + static_cast<size_t>(slot) * lagCapacity;
+    const float* x = samples + startIndex;
+
+    sums[0] = 0.0f;
+    for (int tau = 1; tau < numLags; ++tau)
+        sums[tau] = SimdKernels::sumOfSquaredDifferences(x, x - tau, length);
+
+    blockLengths[slot] = length;
+    coveredLength += length;
+    ++numBlocks;
+}
+
+void SlidingDifference::dropExpiredBlocks()
+{
+    // Keep the smallest set of newest blocks that still spans the integration window
+    while (numBlocks > 1 && coveredLength - blockLengths[firstBlock] >= windowLength)
+    {
+        coveredLength -= blockLengths[firstBlock];
+        firstBlock = (firstBlock + 1) % maxBlocks;
+        --numBlocks;
+    }
+}
+
+void SlidingDifference::sumBlocks()
+{
+    // Re-summing the handful of live blocks each frame avoids the drift of a running add/subtract total
+    std::fill(difference.begin(), difference.begin() + numLags, 0.0f);
+
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        const float* sums = blockSums.data() + static_cast<size_t>((firstBlock + b) % maxBlocks) * lagCapacity;
+        for (int tau = 0; tau < numLags; ++tau)
+            difference[tau] += sums[tau];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Incrementally maintained YIN difference function
+//
+// Uses the fixed integration window form of YIN, d(tau) = sum_j (x[j] - x[j - tau])^2 over the
+// most recent windowLength samples j. The window is kept as a ring of per-hop blocks: each update
+// computes the lag products only for the samples that arrived since the previous frame, and the
+// oldest blocks are dropped once the remaining ones still cover the window. Cost per frame is
+// O(newSamples * numLags) instead of O(N^2), and nothing allocates after prepare().
+class SlidingDifference
+{
+public:
+    void prepare(int maxLags, int windowLength, int historyLength);
+    void reset();
+
+    // Changes the lag count (at most prepare()'s maxLags) and window without allocating; resets the state
+    void configure(int numLags, int windowLength, int historyLength);
+
+    // samples holds the most recent numSamples input samples (oldest to newest) ending at
+    // absolute position endPosition; only the part not seen by the previous call is processed
+    void update(const float* samples, int numSamples, juce::int64 endPosition);
+
+    const float* getDifference() const { return difference.data(); }
+    int getNumLags() const { return numLags; }
+    int getCoveredLength() const { return coveredLength; }
+
+private:
+    void addBlock(const float* samples, int startIndex, int length);
+    void dropExpiredBlocks();
+    void sumBlocks();
+
+    static constexpr int maxBlocks = 64;
+
+    int lagCapacity = 0;
+    int numLags = 0;
+    int windowLength = 0;
+    int resetBlockLength = 0;
+
+    std::vector<float> blockSums;   // maxBlocks x lagCapacity
+    std::vector<int> blockLengths;
+    std::vector<float> difference;
+
+    int firstBlock = 0;
+    int numBlocks = 0;
+    int coveredLength = 0;
+    juce::int64 lastEndPosition = -1;
+};
\ No newline at end of file
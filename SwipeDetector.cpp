@@ -0,0 +1,225 @@
+#include "SwipeDetector.h"
+#include "SimdKernels.h"
+#include <cmath>
+
+namespace
+{
+    // Same search range as the engine's YIN
+    constexpr float minFrequency = 70.0f;
+    constexpr float maxFrequency = 1200.0f;
+
+    bool isPrime(int n)
+    {
+        for (int d = 2; d * d <= n; ++d)
+            if (n % d == 0)
+                return false;
+
+        return n >= 2;
+    }
+}
+
+void SwipeDetector::prepare(double newSampleRate, int minFrameLength, int maxFrameLength)
+{
+    juce::ignoreUnused(minFrameLength);
+
+    sampleRate = newSampleRate;
+    maxPartialFrequency = static_cast<float>(juce::jmin(5000.0, sampleRate * 0.45));
+
+    const int numCandidates = static_cast<int>(std::log2(maxFrequency / minFrequency) * candidatesPerOctave) + 1;
+    candidates.resize(static_cast<size_t>(numCandidates));
+    idealOrders.resize(static_cast<size_t>(numCandidates));
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        candidates[c] = minFrequency * std::pow(2.0f, static_cast<float>(c) / candidatesPerOctave);
+        idealOrders[c] = std::log2(periodsPerWindow * static_cast<float>(sampleRate) / candidates[c]);
+    }
+
+    // Window sizes from the one the highest candidate wants up to the lowest's, or the longest frame
+    minWindowOrder = juce::jmax(4, static_cast<int>(std::floor(idealOrders.back())));
+    const int highestOrder = juce::jmax(minWindowOrder, juce::jmin(static_cast<int>(std::ceil(idealOrders.front())),
+                                                                   juce::findHighestSetBit(static_cast<juce::uint32>(maxFrameLength))));
+
+    resolutions.clear();
+    for (int order = minWindowOrder; order <= highestOrder; ++order)
+    {
+        auto& r = resolutions.emplace_back();
+        const int size = 1 << order;
+
+        r.fft = std::make_unique<juce::dsp::FFT>(order + 1);
+        r.numBins = size + 1;
+        r.binWidth = static_cast<float>(sampleRate / (2 * size));
+        r.loudness.assign(static_cast<size_t>(r.numBins), 0.0f);
+
+        r.window.resize(static_cast<size_t>(size));
+        for (int i = 0; i < size; ++i)
+            r.window[i] = 0.5f * (1.0f - std::cos(2.0f * juce::MathConstants<float>::pi * i / (size - 1)));
+    }
+
+    // Enough harmonics for the lowest candidate to reach maxPartialFrequency (and the half lobe past it)
+    const int maxHarmonic = static_cast<int>(maxPartialFrequency / minFrequency) + 2;
+    harmonicWeights.assign(static_cast<size_t>(maxHarmonic) + 1, 0.0f);
+    for (int k = 1; k <= maxHarmonic; ++k)
+        if (k == 1 || isPrime(k))
+            harmonicWeights[k] = 1.0f / std::sqrt(static_cast<float>(k));
+
+    workspace.assign(static_cast<size_t>(resolutions.back().fft->getSize()) * 2, 0.0f);
+    scores.assign(candidates.size(), 0.0f);
+
+    setFrameLength(maxFrameLength);
+}
+
+void SwipeDetector::setFrameLength(int frameLength)
+{
+    maxWindowOrder = juce::jlimit(minWindowOrder, minWindowOrder + static_cast<int>(resolutions.size()) - 1,
+                                  juce::findHighestSetBit(static_cast<juce::uint32>(frameLength)));
+}
+
+float SwipeDetector::scoreOf(const Resolution& resolution, float f0) const
+{
+    const float binWidth = resolution.binWidth;
+    const float* loudness = resolution.loudness.data();
+
+    // Bins from half an F0 up to the last lobe that fits below maxPartialFrequency
+    const int lo = juce::jmax(1, static_cast<int>(std::ceil(0.5f * f0 / binWidth)));
+    const int hi = juce::jmin(resolution.numBins - 1, static_cast<int>(maxPartialFrequency / binWidth));
+    if (hi <= lo)
+        return 0.0f;
+
+    // The kernel phase advances by the same angle every bin, so it is rotated rather than recomputed
+    const double step = juce::MathConstants<double>::twoPi * binWidth / f0;
+    const double cosStep = std::cos(step), sinStep = std::sin(step);
+    double c = std::cos(step * lo), s = std::sin(step * lo);
+
+    const double ratioStep = static_cast<double>(binWidth) / f0;
+    double ratio = ratioStep * lo;
+
+    double correlation = 0.0, kernelEnergy = 0.0, spectrumEnergy = 0.0;
+
+    for (int b = lo; b <= hi; ++b)
+    {
+        const auto weight = harmonicWeights[static_cast<size_t>(ratio + 0.5)];
+
+        const double k = weight * c;
+        correlation += k * loudness[b];
+        kernelEnergy += k * k;
+        spectrumEnergy += static_cast<double>(loudness[b]) * loudness[b];
+
+        const double nextC = c * cosStep - s * sinStep;
+        s = s * cosStep + c * sinStep;
+        c = nextC;
+        ratio += ratioStep;
+    }
+
+    if (kernelEnergy <= 0.0 || spectrumEnergy <= 0.0)
+        return 0.0f;
+
+    return static_cast<float>(correlation / std::sqrt(kernelEnergy * spectrumEnergy));
+}
+
+float SwipeDetector::refineFrequency(float f0) const
+{
+    // The score peaks too broadly to place F0 within a few cents, so the grid pick is refined from the
+    // interpolated peaks of its first few partials in the longest window, each divided by its number
+    const auto& r = resolutions[static_cast<size_t>(maxWindowOrder - minWindowOrder)];
+    double weightedSum = 0.0;
+    double totalWeight = 0.0;
+
+    for (int h = 1; h <= 5 && h * f0 < maxPartialFrequency; ++h)
+    {
+        const float centre = h * f0 / r.binWidth;
+        const float radius = juce::jmax(1.0f, 0.25f * f0 / r.binWidth);
+        const int lo = juce::jmax(1, static_cast<int>(std::floor(centre - radius)));
+        const int hi = juce::jmin(r.numBins - 2, static_cast<int>(std::ceil(centre + radius)));
+
+        int bin = lo;
+        for (int k = lo + 1; k <= hi; ++k)
+            if (r.loudness[k] > r.loudness[bin])
+                bin = k;
+
+        if (hi <= lo || r.loudness[bin] < r.loudness[bin - 1] || r.loudness[bin] < r.loudness[bin + 1])
+            continue;
+
+        const float s0 = std::log(r.loudness[bin - 1] + 1.0e-9f);
+        const float s1 = std::log(r.loudness[bin] + 1.0e-9f);
+        const float s2 = std::log(r.loudness[bin + 1] + 1.0e-9f);
+        const float denom = s0 - 2.0f * s1 + s2;
+        const float offset = std::abs(denom) > 1.0e-6f ? juce::jlimit(-0.5f, 0.5f, 0.5f * (s0 - s2) / denom) : 0.0f;
+
+        const double weight = static_cast<double>(r.loudness[bin]) * r.loudness[bin];
+        weightedSum += weight * (bin + offset) * r.binWidth / h;
+        totalWeight += weight;
+    }
+
+    if (totalWeight <= 0.0)
+        return f0;
+
+    // A refinement more than a semitone away has locked onto something else
+    const auto refined = static_cast<float>(weightedSum / totalWeight);
+    return std::abs(std::log2(refined / f0)) < 1.0f / 12.0f ? refined : f0;
+}
+
+PitchDetector::Estimate SwipeDetector::detect(const float* samples, int numSamples)
+{
+    Estimate estimate;
+    float* work = workspace.data();
+
+    // Spectra of the newest 2^order samples for every window size that fits the frame
+    for (int order = minWindowOrder; order <= maxWindowOrder; ++order)
+    {
+        auto& r = resolutions[static_cast<size_t>(order - minWindowOrder)];
+        const int size = 1 << order;
+        jassert(size <= numSamples);
+
+        SimdKernels::multiply(work, samples + numSamples - size, r.window.data(), size);
+        std::fill(work + size, work + r.fft->getSize() * 2, 0.0f);
+
+        r.fft->performFrequencyOnlyForwardTransform(work);
+
+        for (int k = 0; k < r.numBins; ++k)
+            r.loudness[k] = std::sqrt(work[k]);
+    }
+
+    int best = 0;
+    for (size_t c = 0; c < candidates.size(); ++c)
+    {
+        // Linear in log2(window size) between the two sizes either side of the ideal one
+        const float position = juce::jlimit(static_cast<float>(minWindowOrder), static_cast<float>(maxWindowOrder), idealOrders[c]);
+        const int lower = juce::jmin(static_cast<int>(position), maxWindowOrder - 1);
+        const float fraction = position - static_cast<float>(lower);
+
+        if (lower < minWindowOrder)
+            scores[c] = scoreOf(resolutions.front(), candidates[c]);
+        else
+            scores[c] = (1.0f - fraction) * scoreOf(resolutions[static_cast<size_t>(lower - minWindowOrder)], candidates[c])
+                      + fraction * scoreOf(resolutions[static_cast<size_t>(lower + 1 - minWindowOrder)], candidates[c]);
+
+        if (scores[c] > scores[static_cast<size_t>(best)])
+            best = static_cast<int>(c);
+    }
+
+    // Parabolic interpolation over the log-frequency grid
+    float position = static_cast<float>(best);
+    float peak = scores[static_cast<size_t>(best)];
+
+    if (best > 0 && best < static_cast<int>(candidates.size()) - 1)
+    {
+        const float s0 = scores[static_cast<size_t>(best - 1)];
+        const float s1 = peak;
+        const float s2 = scores[static_cast<size_t>(best + 1)];
+        const float denom = s0 - 2.0f * s1 + s2;
+
+        if (std::abs(denom) > 0.0001f)
+        {
+            const float offset = juce::jlimit(-1.0f, 1.0f, 0.5f * (s0 - s2) / denom);
+            position += offset;
+            peak -= 0.25f * (s0 - s2) * offset;
+        }
+    }
+
+    estimate.confidence = juce::jlimit(0.0f, 1.0f, peak);
+
+    if (estimate.confidence >= voicedScore)
+        estimate.frequency = refineFrequency(minFrequency * std::pow(2.0f, position / candidatesPerOctave));
+
+    return estimate;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "PitchDetector.h"
+
+// SWIPE-style spectral pitch estimator (after Camacho's SWIPE')
+//
+// Each F0 candidate on a log-spaced grid is scored by the correlation between the square root of
+// the magnitude spectrum and a kernel of cosine lobes, cos(2 pi f / f0) within half an F0 either side
+// of the first harmonic and each prime harmonic, weighted 1 / sqrt(k). Leaving out the composite
+// harmonics means a subharmonic candidate only ever lines up with a few of the partials, so it
+// cannot outscore the true F0. The score is normalised like a correlation coefficient, which makes
+// it usable directly as the confidence.
+//
+// The kernel only matches the spectrum when the window is about eight periods of the candidate
+// long, so the newest part of the frame is analysed with Hann windows of every power-of-two size
+// between the ones the highest and lowest candidates want, and each candidate's score is
+// interpolated between the two sizes either side of its ideal one. Sizes longer than the frame are
+// not used; candidates that want them fall back to the longest that fits. The score peaks broadly,
+// so the winning candidate is refined from the interpolated peaks of its first few partials.
+// Windows, FFTs and the candidate grid are built in prepare(); detect() only walks them.
+class SwipeDetector : public PitchDetector
+{
+public:
+    const char* getName() const override { return "swipe"; }
+
+    void prepare(double sampleRate, int minFrameLength, int maxFrameLength) override;
+    void setFrameLength(int frameLength) override;
+    Estimate detect(const float* samples, int numSamples) override;
+
+private:
+    static constexpr int candidatesPerOctave = 48;
+    static constexpr float periodsPerWindow = 8.0f;
+    static constexpr float voicedScore = 0.25f;  // below this the frame is reported unvoiced
+
+    // One window size; the FFT is twice as long, so every F0 spans at least 16 bins
+    struct Resolution
+    {
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<float> window;
+        std::vector<float> loudness;  // square root of the magnitude spectrum
+        int numBins = 0;
+        float binWidth = 1.0f;
+    };
+
+    float scoreOf(const Resolution& resolution, float f0) const;
+    float refineFrequency(float f0) const;
+
+    double sampleRate = 48000.0;
+    int minWindowOrder = 0;
+    int maxWindowOrder = 0;   // for the current frame length
+    float maxPartialFrequency = 5000.0f;
+
+    std::vector<Resolution> resolutions;  // minWindowOrder upwards
+    std::vector<float> candidates;
+    std::vector<float> idealOrders;       // log2 of each candidate's ideal window size
+    std::vector<float> harmonicWeights;   // 1 / sqrt(k) for 1 and the primes, 0 otherwise
+    std::vector<float> workspace;
+    std::vector<float> scores;
+};
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "Tuning.h"
+#include <cmath>
+
+namespace Tuning
+{
+    const Table& getTable(double referencePitch, const Scale& scale)
+    {
+        if (referencePitch == standard.getReferencePitch() && scale == standard.getScale())
+            return standard;
+
+        // Bounded in practice by the reference pitch parameter's 0.1 Hz steps and the scales loaded
+        static juce::CriticalSection lock;
+        static std::vector<std::unique_ptr<const Table>> tables;
+
+        const juce::ScopedLock scopedLock(lock);
+        for (const auto& table : tables)
+            if (table->getReferencePitch() == referencePitch && table->getScale() == scale)
+                return *table;
+
+        tables.push_back(std::make_unique<const Table>(referencePitch, scale));
+        return *tables.back();
+    }
+
+    bool parseScala(const juce::String& text, Scale& scale, juce::String& description, juce::String& error)
+    {
+        juce::StringArray lines;
+        for (const auto& line : juce::StringArray::fromLines(text))
+            if (!line.startsWithChar('!'))
+                lines.add(line);
+
+        // The description may be blank, but the line has to be there
+        if (lines.size() < 2)
+        {
+            error = "Not a Scala file: no note count";
+            return false;
+        }
+
+        description = lines[0].trim();
+
+        const int numNotes = lines[1].trim().getIntValue();
+        if (numNotes != 12)
+        {
+            error = "Only 12-note scales can be named as MIDI notes (this one has " + juce::String(numNotes) + ")";
+            return false;
+        }
+
+        if (lines.size() < 2 + numNotes)
+        {
+            error = "The file lists fewer than " + juce::String(numNotes) + " pitches";
+            return false;
+        }
+
+        Scale parsed;
+        parsed.ratios[0] = 1.0;
+
+        for (int i = 1; i <= numNotes; ++i)
+        {
+            // Only the first token counts; anything after it is a comment
+            const auto token = lines[1 + i].trim().initialSectionNotContaining(" \t");
+            double ratio = 0.0;
+
+            if (token.containsChar('.'))
+                ratio = std::pow(2.0, token.getDoubleValue() / 1200.0);
+            else if (token.containsChar('/'))
+                ratio = token.upToFirstOccurrenceOf("/", false, false).getDoubleValue()
+                      / token.fromFirstOccurrenceOf("/", false, false).getDoubleValue();
+            else
+                ratio = token.getDoubleValue();
+
+            if (!(ratio > 0.0) || !std::isfinite(ratio))
+            {
+                error = "Unreadable pitch \"" + token + "\" on degree " + juce::String(i);
+                return false;
+            }
+
+            if (i < numNotes)
+                parsed.ratios[static_cast<size_t>(i)] = ratio;
+            else
+                parsed.period = ratio;
+        }
+
+        // Note boundaries are searched in order, so the degrees must rise up to the period
+        for (size_t i = 1; i < parsed.ratios.size(); ++i)
+            if (parsed.ratios[i] <= parsed.ratios[i - 1])
+            {
+                error = "Scale degrees must rise within the period";
+                return false;
+            }
+
+        if (parsed.period <= parsed.ratios.back())
+        {
+            error = "Scale degrees must rise within the period";
+            return false;
+        }
+
+        scale = parsed;
+        return true;
+    }
+}
\ No newline at end of file
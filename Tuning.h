@@ -0,0 +1,171 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// Frequency-to-note mapping for a reference pitch and a 12-note temperament
+//
+// A Table holds the centre frequency of every MIDI note and the geometric midpoints between
+// neighbours, so lookup() finds the nearest note with a fixed seven-step binary search and gets the
+// offset in cents from a short atanh series instead of a log. Note names are formatted at compile
+// time. Tables are immutable: the 12-TET, A4 = 440 Hz one is constexpr, and getTable() builds the
+// others once per reference pitch and scale and hands every instance in the process the same copy.
+//
+// Every temperament keeps A4 (MIDI note 69) on the reference pitch; scales are given as ratios
+// above C, so a just or Scala scale is played in C with its A moved to the reference.
+namespace Tuning
+{
+    constexpr int numNotes = 128;
+    constexpr int referenceNote = 69;  // A4
+
+    namespace detail
+    {
+        constexpr double sqrt(double x)
+        {
+            double y = x > 1.0 ? x : 1.0;
+            for (int i = 0; i < 64; ++i)
+                y = 0.5 * (y + x / y);
+            return y;
+        }
+
+        constexpr double power(double x, int n)
+        {
+            double y = 1.0;
+            for (int i = 0; i < (n < 0 ? -n : n); ++i)
+                y *= x;
+            return n < 0 ? 1.0 / y : y;
+        }
+
+        // Newton's method on y^n = x
+        constexpr double root(double x, int n)
+        {
+            double y = x;
+            for (int i = 0; i < 64; ++i)
+                y -= (power(y, n) - x) / (n * power(y, n - 1));
+            return y;
+        }
+    }
+
+    // "C#4"-style name, octaves numbered as juce::MidiMessage::getMidiNoteName(note, ..., 4) does
+    struct NoteName
+    {
+        char text[6];
+    };
+
+    constexpr std::array<NoteName, numNotes> makeNoteNames(const char* const (&pitchClasses)[12])
+    {
+        std::array<NoteName, numNotes> names{};
+        for (int note = 0; note < numNotes; ++note)
+        {
+            auto& text = names[static_cast<size_t>(note)].text;
+            int length = 0;
+            for (const char* c = pitchClasses[note % 12]; *c != 0; ++c)
+                text[length++] = *c;
+
+            const int octave = note / 12 - 1;
+            if (octave < 0)
+                text[length++] = '-';
+            text[length++] = static_cast<char>('0' + (octave < 0 ? -octave : octave));
+            text[length] = 0;
+        }
+        return names;
+    }
+
+    constexpr const char* sharpPitchClasses[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+    constexpr const char* flatPitchClasses[12] = { "C", "Db", "D", "Eb", "E", "F", "Gb", "G", "Ab", "A", "Bb", "B" };
+
+    inline constexpr auto sharpNames = makeNoteNames(sharpPitchClasses);
+    inline constexpr auto flatNames = makeNoteNames(flatPitchClasses);
+
+    // Frequency ratios of the twelve pitch classes above C (ratios[0] is 1) and the interval they
+    // repeat at, normally an octave
+    struct Scale
+    {
+        std::array<double, 12> ratios{};
+        double period = 2.0;
+
+        bool operator==(const Scale& other) const { return ratios == other.ratios && period == other.period; }
+    };
+
+    constexpr Scale equalTemperament()
+    {
+        Scale scale;
+        const double semitone = detail::root(2.0, 12);
+        scale.ratios[0] = 1.0;
+        for (size_t i = 1; i < 12; ++i)
+            scale.ratios[i] = scale.ratios[i - 1] * semitone;
+        return scale;
+    }
+
+    // 5-limit just intonation on C
+    inline constexpr Scale justIntonation{ { 1.0, 16.0 / 15.0, 9.0 / 8.0, 6.0 / 5.0, 5.0 / 4.0, 4.0 / 3.0,
+                                             45.0 / 32.0, 3.0 / 2.0, 8.0 / 5.0, 5.0 / 3.0, 9.0 / 5.0, 15.0 / 8.0 }, 2.0 };
+
+    struct Note
+    {
+        int midiNote = -1;    // -1 outside the table's range
+        float cents = 0.0f;   // from the note's centre in this tuning
+    };
+
+    class Table
+    {
+    public:
+        constexpr Table(double referencePitch, const Scale& tableScale)
+            : reference(referencePitch), scale(tableScale)
+        {
+            for (int note = 0; note < numNotes; ++note)
+                centres[static_cast<size_t>(note)] = static_cast<float>(frequencyOf(note));
+
+            for (int note = 0; note <= numNotes; ++note)
+                edges[static_cast<size_t>(note)] = static_cast<float>(detail::sqrt(frequencyOf(note - 1) * frequencyOf(note)));
+        }
+
+        // Real-time safe: no allocation, no log
+        Note lookup(float frequency) const noexcept
+        {
+            if (!(frequency >= edges.front() && frequency < edges.back()))
+                return {};
+
+            // Largest note whose lower edge is at or below the frequency; numNotes is a power of two
+            int note = 0;
+            for (int step = numNotes / 2; step > 0; step /= 2)
+                note += edges[static_cast<size_t>(note + step)] <= frequency ? step : 0;
+
+            // 1200 log2(f / c) = (2400 / ln 2) atanh(u) with u = (f - c) / (f + c); two terms are good to
+            // a thousandth of a cent for steps up to a major third
+            const float centre = centres[static_cast<size_t>(note)];
+            const float u = (frequency - centre) / (frequency + centre);
+            return { note, 3462.4681f * u * (1.0f + u * u * (1.0f / 3.0f)) };
+        }
+
+        float getFrequency(int midiNote) const { return centres[static_cast<size_t>(midiNote)]; }
+        double getReferencePitch() const { return reference; }
+        const Scale& getScale() const { return scale; }
+
+    private:
+        constexpr double frequencyOf(int note) const
+        {
+            // Floor division, so the edge below note 0 comes from the B an octave below
+            const int octave = (note - (note < 0 ? 11 : 0)) / 12;
+            const int pitchClass = note - 12 * octave;
+            return reference * scale.ratios[static_cast<size_t>(pitchClass)] / scale.ratios[referenceNote % 12]
+                 * detail::power(scale.period, octave - referenceNote / 12);
+        }
+
+        double reference;
+        Scale scale;
+        std::array<float, numNotes> centres{};
+        std::array<float, numNotes + 1> edges{};  // edges[n] is the lower edge of note n
+    };
+
+    inline constexpr Table standard{ 440.0, equalTemperament() };
+
+    // The shared table for this reference pitch and scale, built on first use and kept for the
+    // lifetime of the process. Takes a lock and may allocate, so not for the audio or analysis threads.
+    const Table& getTable(double referencePitch, const Scale& scale);
+
+    // Reads a Scala .scl file: a description line, the number of notes, then one pitch per line as
+    // cents (with a '.') or a ratio, the last being the period. Only 12-note scales map onto MIDI
+    // note names; anything else, or degrees that do not rise, fails with a message in error.
+    bool parseScala(const juce::String& text, Scale& scale, juce::String& description, juce::String& error);
+}
\ No newline at end of file
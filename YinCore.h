@@ -0,0 +1,243 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdKernels.h"
+
+// YIN detector core, templated on how its long reductions are accumulated
+//
+// The frame energy, the difference sums (up to 16384 products per lag) and the CMND running sum
+// (up to 8192 lags) all feed the threshold and the parabolic refinement, so their rounding shows
+// up in the result as windows grow. Each policy supplies those three reductions:
+//
+//   Float     the SIMD kernels as they are: float lanes added together at the end. The default.
+//   Double    scalar double accumulators throughout; the slow reference for the others.
+//   Pairwise  SIMD float sums over short blocks, with block results combined pairwise (and the
+//             CMND scan restarted from a double total every block), so rounding grows with
+//             log(n) rather than n at close to float speed.
+//
+// PITCHDETECTOR_ACCUMULATION picks the policy the engine is built with (0 float, 1 double,
+// 2 pairwise), so the default build has no branch for it. The Benchmarks tool instantiates all
+// three side by side (--accumulation).
+#ifndef PITCHDETECTOR_ACCUMULATION
+ #define PITCHDETECTOR_ACCUMULATION 0
+#endif
+
+namespace Accumulation
+{
+    struct Float
+    {
+        static constexpr const char* name = "float";
+
+        static float sumOfSquares(const float* x, int n) { return SimdKernels::sumOfSquares(x, n); }
+        static float sumOfSquaredDifferences(const float* a, const float* b, int n) { return SimdKernels::sumOfSquaredDifferences(a, b, n); }
+        static void cumulativeMeanNormalise(float* diff, int numLags) { SimdKernels::cumulativeMeanNormalise(diff, numLags); }
+    };
+
+    struct Double
+    {
+        static constexpr const char* name = "double";
+
+        static float sumOfSquares(const float* x, int n)
+        {
+            double sum = 0.0;
+            for (int i = 0; i < n; ++i)
+                sum += static_cast<double>(x[i]) * x[i];
+            return static_cast<float>(sum);
+        }
+
+        static float sumOfSquaredDifferences(const float* a, const float* b, int n)
+        {
+            double sum = 0.0;
+            for (int i = 0; i < n; ++i)
+            {
+                const double delta = static_cast<double>(a[i]) - b[i];
+                sum += delta * delta;
+            }
+            return static_cast<float>(sum);
+        }
+
+        static void cumulativeMeanNormalise(float* diff, int numLags)
+        {
+            if (numLags <= 0)
+                return;
+
+            diff[0] = 0.0f;
+            double runningSum = 0.0;
+
+            for (int tau = 1; tau < numLags; ++tau)
+            {
+                runningSum += diff[tau];
+                diff[tau] = runningSum > 0.0 ? static_cast<float>(diff[tau] * tau / runningSum) : 1.0f;
+            }
+        }
+    };
+
+    struct Pairwise
+    {
+        static constexpr const char* name = "pairwise";
+        static constexpr int blockSize = 256;  // summed in SIMD lanes, so each lane adds 32-64 terms
+
+        // Halves the range until it fits a block, so block results meet in a balanced tree
+        template <typename BlockSum>
+        static float sumPairwise(int start, int n, BlockSum&& blockSum)
+        {
+            if (n <= blockSize)
+                return blockSum(start, n);
+
+            const int half = (n / 2 + blockSize - 1) / blockSize * blockSize;
+            return sumPairwise(start, half, blockSum) + sumPairwise(start + half, n - half, blockSum);
+        }
+
+        static float sumOfSquares(const float* x, int n)
+        {
+            return sumPairwise(0, n, [x](int start, int count) { return SimdKernels::sumOfSquares(x + start, count); });
+        }
+
+        static float sumOfSquaredDifferences(const float* a, const float* b, int n)
+        {
+            return sumPairwise(0, n, [a, b](int start, int count) { return SimdKernels::sumOfSquaredDifferences(a + start, b + start, count); });
+        }
+
+        static void cumulativeMeanNormalise(float* diff, int numLags)
+        {
+            if (numLags <= 0)
+                return;
+
+            diff[0] = 0.0f;
+            double runningSum = 0.0;
+
+            // The vector scan only carries float rounding across one block; the total between blocks is kept in double
+            for (int start = 1; start < numLags; start += blockSize)
+            {
+                const int end = juce::jmin(numLags, start + blockSize);
+                const float blockTotal = SimdKernels::sum(diff + start, end - start);
+
+                SimdKernels::cumulativeMeanNormalise(diff, start, end, static_cast<float>(runningSum));
+                runningSum += blockTotal;
+            }
+        }
+    };
+
+   #if PITCHDETECTOR_ACCUMULATION == 1
+    using Default = Double;
+   #elif PITCHDETECTOR_ACCUMULATION == 2
+    using Default = Pairwise;
+   #else
+    using Default = Float;
+   #endif
+}
+
+template <typename Accumulation>
+struct YinCore
+{
+    // Blocking for differenceDirectTiled(): a tile of x plus a block of lags past it is about 9 KB per stream
+    static constexpr int tileLength = 2048;
+    static constexpr int lagsPerBlock = 128;
+
+    static float rms(const float* x, int numSamples)
+    {
+        return std::sqrt(Accumulation::sumOfSquares(x, numSamples) / numSamples);
+    }
+
+    // d(tau) = sum (x[i] - x[i + tau])^2 over the full overlap, for tau < numLags
+    static void differenceDirect(const float* x, int numSamples, float* diff, int numLags)
+    {
+        for (int tau = 0; tau < numLags; ++tau)
+            diff[tau] = Accumulation::sumOfSquaredDifferences(x, x + tau, numSamples - tau);
+    }
+
+    // Same sums for tau in [lagBegin, lagEnd), evaluated a block of lags at a time and tiled over i, so
+    // each tile of x and the stretch a block of lags reads after it stay in L1 while the block sweeps
+    // them. Tiles are summed with the policy and combined in double. Blocks of lags are independent,
+    // so callers may run separate ranges on separate threads.
+    static void differenceDirectTiled(const float* x, int numSamples, float* diff, int lagBegin, int lagEnd)
+    {
+        double sums[lagsPerBlock];
+
+        for (int blockStart = lagBegin; blockStart < lagEnd; blockStart += lagsPerBlock)
+        {
+            const int blockLength = juce::jmin(lagsPerBlock, lagEnd - blockStart);
+            std::fill(sums, sums + blockLength, 0.0);
+
+            for (int tileStart = 0; tileStart < numSamples - blockStart; tileStart += tileLength)
+            {
+                for (int lag = 0; lag < blockLength; ++lag)
+                {
+                    const int tau = blockStart + lag;
+                    const int count = juce::jmin(tileLength, numSamples - tau - tileStart);
+
+                    if (count > 0)
+                        sums[lag] += Accumulation::sumOfSquaredDifferences(x + tileStart, x + tileStart + tau, count);
+                }
+            }
+
+            for (int lag = 0; lag < blockLength; ++lag)
+                diff[blockStart + lag] = static_cast<float>(sums[lag]);
+        }
+    }
+
+    static void cumulativeMeanNormalise(float* diff, int numLags)
+    {
+        Accumulation::cumulativeMeanNormalise(diff, numLags);
+    }
+
+    // d(tau) over the energy of the two overlapping parts: 0 for a periodic frame, around 1 for noise
+    static float normalisedDifference(const float* x, int numSamples, int tau, float totalEnergy)
+    {
+        const float difference = Accumulation::sumOfSquaredDifferences(x, x + tau, numSamples - tau);
+        const float energy = 2.0f * totalEnergy - Accumulation::sumOfSquares(x, tau) - Accumulation::sumOfSquares(x + numSamples - tau, tau);
+        return energy > 0.0f ? difference / energy : 1.0f;
+    }
+
+    // YIN's period pick on a CMND curve: the first dip below threshold in [minTau, maxTau), else the
+    // lowest point, refined by parabolic interpolation. Returns 0 when there is no usable minimum.
+    static float findPeriod(const float* cmnd, int numLags, int minTau, int maxTau, float threshold)
+    {
+        int bestTau = 0;
+
+        // Find first local minimum below threshold
+        for (int tau = minTau; tau < maxTau; ++tau)
+        {
+            if (cmnd[tau] < threshold)
+            {
+                if (cmnd[tau] < cmnd[tau - 1] && cmnd[tau] < cmnd[tau + 1])
+                {
+                    bestTau = tau;
+                    break;
+                }
+            }
+        }
+
+        // Fallback to global minimum
+        if (bestTau == 0)
+        {
+            float minVal = 1.0f;
+            for (int tau = minTau; tau < maxTau; ++tau)
+            {
+                if (cmnd[tau] < minVal)
+                {
+                    minVal = cmnd[tau];
+                    bestTau = tau;
+                }
+            }
+        }
+
+        if (bestTau < 2 || bestTau >= numLags - 1)
+            return 0.0f;
+
+        // Parabolic interpolation
+        const float s0 = cmnd[bestTau - 1];
+        const float s1 = cmnd[bestTau];
+        const float s2 = cmnd[bestTau + 1];
+
+        float refinedTau = static_cast<float>(bestTau);
+        const float denom = (s0 - 2.0f * s1 + s2);
+        if (std::abs(denom) > 0.0001f)
+        {
+            const float offset = 0.5f * (s0 - s2) / denom;
+            refinedTau += juce::jlimit(-1.0f, 1.0f, offset);
+        }
+
+        return refinedTau;
+    }
+};
\ No newline at end of file